@@ -7,7 +7,7 @@ set SRC_DIR=..\src\
 set SDL_DIR=C:\SDL2-2.0.10\
 
 :: Debug messages etc
-set ADDITIONAL_FLAGS=/DSTDOUT_DEBUG /DFIXED_GAME_MEMORY /DPLATFORM_GL_MAJOR_VERSION=3 /DPLATFORM_GL_MINOR_VERSION=3
+set ADDITIONAL_FLAGS=/DSTDOUT_DEBUG /DPROFILER /DFIXED_GAME_MEMORY /DPLATFORM_GL_MAJOR_VERSION=3 /DPLATFORM_GL_MINOR_VERSION=3
 
 :: Disabled warnings
 :: /wd4100  unreferenced formal parameter
@@ -47,6 +47,6 @@ IF NOT EXIST SDL2.dll copy %SDL_DIR%\lib\x64\SDL2.dll .
 IF EXIST %EXE_NAME% del %EXE_NAME%
 
 :: Build executable
-cl %SRC_DIR%\sdl_main.cpp %SRC_DIR%\game.cpp %SRC_DIR%\gl_rendering.cpp %SRC_DIR%\physics.cpp %SRC_DIR%\math.cpp %SRC_DIR%\glad.c %COMMON_COMPILER_FLAGS% %ADDITIONAL_FLAGS% /link %COMMON_LINKER_FLAGS%
+cl %SRC_DIR%\sdl_main.cpp %SRC_DIR%\input_recording.cpp %SRC_DIR%\histogram.cpp %SRC_DIR%\frame_pacer.cpp %SRC_DIR%\frame_capture.cpp %SRC_DIR%\platform_files.cpp %SRC_DIR%\platform_memory.cpp %SRC_DIR%\game.cpp %SRC_DIR%\scene_file.cpp %SRC_DIR%\scene_gen.cpp %SRC_DIR%\profiler.cpp %SRC_DIR%\trace.cpp %SRC_DIR%\stats_log.cpp %SRC_DIR%\gl_rendering.cpp %SRC_DIR%\physics.cpp %SRC_DIR%\math.cpp %SRC_DIR%\glad.c %COMMON_COMPILER_FLAGS% %ADDITIONAL_FLAGS% /link %COMMON_LINKER_FLAGS%
 
 cd ..
\ No newline at end of file
@@ -1,38 +1,146 @@
 #/bin/bash
+# usage: [RENDERER=gl|software|null] build.sh [target...]
+# targets: sim (default), sim_headless, scene_gen, bench, stats_dump
+# RENDERER picks the renderer for sim and sim_headless, which default to gl and null.
+# software rasterizes on the CPU, see sw_rendering.h; null draws nothing, see null_rendering.h
+TARGETS=${@:-sim}
+
 rm -rf build
 mkdir -p build
 cd build
 
-EXECUTABLE_NAME=sim
+SRC_DIR="../../src"
+INCLUDE_DIR="../../src/include"
+
+# sim: SDL window, OpenGL rendering
+SIM_GAME_SRCS="game.cpp scene_file.cpp scene_gen.cpp profiler.cpp trace.cpp stats_log.cpp math.cpp"
+SIM_PLATFORM_SRCS="sdl_main.cpp input_recording.cpp histogram.cpp frame_pacer.cpp frame_capture.cpp platform_files.cpp platform_memory.cpp"
+SIM_LINKER_FLAGS="-lSDL2 -ldl -pthread" # -lSDL2_image
+SIM_FLAGS="-pthread"
+SIM_RENDERER=${RENDERER:-gl}
+
+# sim_headless: no window, replays input recordings
+SIM_HEADLESS_GAME_SRCS="game.cpp scene_file.cpp scene_gen.cpp profiler.cpp trace.cpp stats_log.cpp math.cpp"
+SIM_HEADLESS_PLATFORM_SRCS="headless_main.cpp input_recording.cpp histogram.cpp platform_files.cpp platform_memory.cpp"
+SIM_HEADLESS_LINKER_FLAGS=""
+SIM_HEADLESS_FLAGS=""
+SIM_HEADLESS_RENDERER=${RENDERER:-null}
 
-SRC_DIR="../src"
-INCLUDE_DIR="../src/include"
-GAME_SRCS="game.cpp gl_rendering.cpp glad.c math.cpp"
-GAME_OBJS="game.o gl_rendering.o glad.o math.o"
-PLATFORM_SOURCES="sdl_main.cpp"
-PLATFORM_OBJS="sdl_main.o"
+# scene_gen: writes generated stress scenes to scene files
+SCENE_GEN_GAME_SRCS="game.cpp scene_file.cpp scene_gen.cpp profiler.cpp trace.cpp stats_log.cpp math.cpp"
+SCENE_GEN_PLATFORM_SRCS="scene_gen_main.cpp platform_files.cpp"
+SCENE_GEN_LINKER_FLAGS=""
+SCENE_GEN_FLAGS=""
+SCENE_GEN_RENDERER=null
 
-OTHER_FLAGS="-DSTDOUT_DEBUG -DFIXED_GAME_MEMORY -DPLATFORM_GL_MAJOR_VERSION=3 -DPLATFORM_GL_MINOR_VERSION=3 -DASSETS_DIR=\"assets/\""""
+# bench: microbenchmarks of physics and math kernels, optimized
+BENCH_GAME_SRCS="game.cpp scene_file.cpp scene_gen.cpp profiler.cpp trace.cpp stats_log.cpp math.cpp"
+BENCH_PLATFORM_SRCS="bench_main.cpp platform_files.cpp"
+BENCH_LINKER_FLAGS=""
+BENCH_FLAGS="-O2"
+BENCH_RENDERER=null
+
+# stats_dump: prints physics stats logs as CSV
+STATS_DUMP_GAME_SRCS="stats_log.cpp"
+STATS_DUMP_PLATFORM_SRCS="stats_dump_main.cpp"
+STATS_DUMP_LINKER_FLAGS=""
+STATS_DUMP_FLAGS=""
+STATS_DUMP_RENDERER=""
+
+OTHER_FLAGS="-DSTDOUT_DEBUG -DPROFILER -DFIXED_GAME_MEMORY -DPLATFORM_GL_MAJOR_VERSION=3 -DPLATFORM_GL_MINOR_VERSION=3 -DASSETS_DIR=\"assets/\""""
 COMPILER_FLAGS="-c -Wall -I$INCLUDE_DIR -fPIC"
 
-LINKER_FLAGS="-lSDL2 -ldl" # -lSDL2_image
+for target in ${TARGETS}; do
+    case ${target} in
+        sim)
+            PLATFORM_SRCS=${SIM_PLATFORM_SRCS}
+            GAME_SRCS=${SIM_GAME_SRCS}
+            LINKER_FLAGS=${SIM_LINKER_FLAGS}
+            TARGET_FLAGS=${SIM_FLAGS}
+            TARGET_RENDERER=${SIM_RENDERER}
+            ;;
+        sim_headless)
+            PLATFORM_SRCS=${SIM_HEADLESS_PLATFORM_SRCS}
+            GAME_SRCS=${SIM_HEADLESS_GAME_SRCS}
+            LINKER_FLAGS=${SIM_HEADLESS_LINKER_FLAGS}
+            TARGET_FLAGS=${SIM_HEADLESS_FLAGS}
+            TARGET_RENDERER=${SIM_HEADLESS_RENDERER}
+            ;;
+        scene_gen)
+            PLATFORM_SRCS=${SCENE_GEN_PLATFORM_SRCS}
+            GAME_SRCS=${SCENE_GEN_GAME_SRCS}
+            LINKER_FLAGS=${SCENE_GEN_LINKER_FLAGS}
+            TARGET_FLAGS=${SCENE_GEN_FLAGS}
+            TARGET_RENDERER=${SCENE_GEN_RENDERER}
+            ;;
+        bench)
+            PLATFORM_SRCS=${BENCH_PLATFORM_SRCS}
+            GAME_SRCS=${BENCH_GAME_SRCS}
+            LINKER_FLAGS=${BENCH_LINKER_FLAGS}
+            TARGET_FLAGS=${BENCH_FLAGS}
+            TARGET_RENDERER=${BENCH_RENDERER}
+            ;;
+        stats_dump)
+            PLATFORM_SRCS=${STATS_DUMP_PLATFORM_SRCS}
+            GAME_SRCS=${STATS_DUMP_GAME_SRCS}
+            LINKER_FLAGS=${STATS_DUMP_LINKER_FLAGS}
+            TARGET_FLAGS=${STATS_DUMP_FLAGS}
+            TARGET_RENDERER=${STATS_DUMP_RENDERER}
+            ;;
+        *)
+            echo "unknown target: ${target}"
+            exit 1
+            ;;
+    esac
 
-echo "compiling platform"
-for src in ${PLATFORM_SOURCES}; do
-    echo "  $src"
-    g++ ${SRC_DIR}/${src} ${COMPILER_FLAGS} ${OTHER_FLAGS} || exit 1
-done
+    case ${TARGET_RENDERER} in
+        gl)
+            GAME_SRCS="${GAME_SRCS} gl_rendering.cpp glad.c"
+            ;;
+        software)
+            GAME_SRCS="${GAME_SRCS} sw_rendering.cpp"
+            TARGET_FLAGS="${TARGET_FLAGS} -DRENDERER_SOFTWARE -pthread"
+            LINKER_FLAGS="${LINKER_FLAGS} -pthread"
+            ;;
+        null)
+            GAME_SRCS="${GAME_SRCS} null_rendering.cpp"
+            TARGET_FLAGS="${TARGET_FLAGS} -DRENDERER_NULL"
+            ;;
+        "")
+            ;;
+        *)
+            echo "unknown renderer: ${TARGET_RENDERER}"
+            exit 1
+            ;;
+    esac
 
-echo "compiling game"
-for src in ${GAME_SRCS}; do
-    echo "  $src"
-    g++ ${SRC_DIR}/${src} ${COMPILER_FLAGS} ${OTHER_FLAGS} || exit 1
-done
+    # each target gets its own objects, as flags differ between targets
+    echo "building ${target}"
+    mkdir -p ${target}
+    cd ${target}
 
-echo "linking"
-g++ ${PLATFORM_OBJS} ${GAME_OBJS} ${LINKER_FLAGS} -o ${EXECUTABLE_NAME} || exit 1
-echo "done"
+    echo "compiling platform"
+    for src in ${PLATFORM_SRCS}; do
+        echo "  $src"
+        g++ ${SRC_DIR}/${src} ${COMPILER_FLAGS} ${OTHER_FLAGS} ${TARGET_FLAGS} || exit 1
+    done
+
+    echo "compiling game"
+    for src in ${GAME_SRCS}; do
+        echo "  $src"
+        g++ ${SRC_DIR}/${src} ${COMPILER_FLAGS} ${OTHER_FLAGS} ${TARGET_FLAGS} || exit 1
+    done
 
+    echo "linking"
+    OBJS=""
+    for src in ${PLATFORM_SRCS} ${GAME_SRCS}; do
+        OBJS="${OBJS} ${src%.*}.o"
+    done
+    g++ ${OBJS} ${LINKER_FLAGS} -o ${target} || exit 1
+
+    cd ..
+    mv ${target}/${target} ..
+done
+echo "done"
 
 cd ..
-mv build/${EXECUTABLE_NAME} .
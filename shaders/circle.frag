@@ -0,0 +1,26 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec4 color_blend;
+in vec2 local;
+
+// draw a 1px outline and a radius showing the rotation, instead of filling
+uniform bool outline = false;
+
+void main()
+{
+    float dist = length(local);
+    float pixel = fwidth(dist);     // size of a pixel in local units
+    float coverage = clamp((1.0 - dist) / pixel, 0.0, 1.0);
+    if (outline)
+    {
+        float ring = clamp((dist - (1.0 - 2.0 * pixel)) / pixel, 0.0, 1.0);
+        float radius = local.x > 0.0 ? clamp(1.0 - abs(local.y) / fwidth(local.y), 0.0, 1.0) : 0.0;
+        coverage *= max(ring, radius);
+    }
+    if (coverage <= 0.0)
+        discard;
+
+    // same blending over white as the other shaders, the alpha is only coverage
+    FragColor = vec4(vec3(1.0) * (1 - color_blend.a) + color_blend.xyz * color_blend.a, coverage);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) in vec3 in_vert;
+
+// per instance
+layout (location = 2) in vec3 in_pos_rot;  // centre x, y, and rotation
+layout (location = 3) in vec2 in_size;     // scale applied to the unit mesh
+layout (location = 4) in vec4 in_color;
+
+out vec4 color_blend;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+};
+
+void main()
+{
+    float c = cos(in_pos_rot.z);
+    float s = sin(in_pos_rot.z);
+    vec2 scaled = in_vert.xy * in_size;
+    vec2 world = vec2(c * scaled.x - s * scaled.y, s * scaled.x + c * scaled.y) + in_pos_rot.xy;
+    gl_Position = projection * view * vec4(world, 0.0, 1.0);
+    color_blend = in_color;
+}
@@ -0,0 +1,10 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec4 color_blend;
+
+void main()
+{
+    // same as the sprite shader blending over the empty (white) texture
+    FragColor = vec4(vec3(1.0) * (1 - color_blend.a) + color_blend.xyz * color_blend.a, 1.0);
+}
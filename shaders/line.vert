@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) in vec2 in_vert;
+layout (location = 4) in vec4 in_color;
+
+out vec4 color_blend;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+};
+
+void main()
+{
+    gl_Position = projection * view * vec4(in_vert, 0.0, 1.0);
+    color_blend = in_color;
+}
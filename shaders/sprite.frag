@@ -2,11 +2,10 @@
 out vec4 FragColor;
 
 in vec2 tex_coord;
+in vec4 color_blend;
 
 uniform sampler2D sprite_texture;
 
-uniform vec4 color_blend = vec4(1.0, 0.0, 0.0, 0.5);
-
 void main()
 {
     vec4 final_color = texture(sprite_texture, tex_coord);
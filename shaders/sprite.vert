@@ -1,15 +1,28 @@
 #version 330 core
 layout (location = 0) in vec3 in_vert;
-layout (location = 1) in vec2 in_tex_coord;
+
+// per instance
+layout (location = 2) in vec3 in_pos_rot;  // centre x, y, and rotation
+layout (location = 3) in vec2 in_size;     // scale applied to the unit mesh
+layout (location = 4) in vec4 in_color;
+layout (location = 5) in vec4 in_tex_rect; // atlas page tex coords at the bottom left corner, then the top right
 
 out vec2 tex_coord;
+out vec4 color_blend;
 
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 model;
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+};
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(in_vert, 1.0);
-    tex_coord = in_tex_coord;
+    float c = cos(in_pos_rot.z);
+    float s = sin(in_pos_rot.z);
+    vec2 scaled = in_vert.xy * in_size;
+    vec2 world = vec2(c * scaled.x - s * scaled.y, s * scaled.x + c * scaled.y) + in_pos_rot.xy;
+    gl_Position = projection * view * vec4(world, 0.0, 1.0);
+    tex_coord = mix(in_tex_rect.xy, in_tex_rect.zw, in_vert.xy + 0.5);
+    color_blend = in_color;
 }
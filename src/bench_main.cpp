@@ -0,0 +1,286 @@
+/*
+ * Microbenchmarks for the hot physics and math kernels
+ * Each kernel runs over a seeded random corpus of poses, so numbers are comparable between builds
+ */
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<time.h>
+#endif
+
+#include"game.h"
+
+#define CORPUS_SIZE 4096
+
+static u64 get_time_ns()
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (u64)((f64)counter.QuadPart * 1e9 / (f64)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+#endif
+}
+
+/* Results are folded into this so the compiler can't drop the work */
+static volatile f32 sink;
+
+struct Corpus
+{
+    Obj circles[CORPUS_SIZE];
+    Obj rects[CORPUS_SIZE];
+    Vec2 rect_verts[CORPUS_SIZE][4];
+    Mat4 mats[CORPUS_SIZE];
+    Vec4 vec4s[CORPUS_SIZE];
+    Vec2 vec2s[CORPUS_SIZE];
+};
+
+static Corpus corpus;
+
+static void init_corpus(u32 seed)
+{
+    RandomGenerator rng(seed);
+    /* Sizes and spread give a mix of overlapping and separate pairs */
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        Vec2 pos = Vec2(rng.range(-0.5F, 0.5F), rng.range(-0.5F, 0.5F));
+        corpus.circles[i] = Obj::dyn_circle(rng.range(0.05F, 0.3F), pos, 1);
+
+        pos = Vec2(rng.range(-0.5F, 0.5F), rng.range(-0.5F, 0.5F));
+        corpus.rects[i] = Obj::dyn_rect(rng.range(0.05F, 0.5F), rng.range(0.05F, 0.5F), pos, rng.range(0.0F, 2.0F * M_PI), 1);
+        get_rect_verts(&corpus.rects[i], corpus.rect_verts[i]);
+
+        Mat4 m = Mat4::identity()
+                    .frame_translate(Vec3(rng.range(-1.0F, 1.0F), rng.range(-1.0F, 1.0F), 0.0F))
+                    .frame_rotate_z(rng.range(0.0F, 2.0F * M_PI));
+        corpus.mats[i] = m.frame_scale(rng.range(0.1F, 10.0F));
+        corpus.vec4s[i] = Vec4(rng.range(-1.0F, 1.0F), rng.range(-1.0F, 1.0F), rng.range(-1.0F, 1.0F), 1.0F);
+        corpus.vec2s[i] = Vec2(rng.range(-10.0F, 10.0F), rng.range(-10.0F, 10.0F));
+    }
+}
+
+/* Each kernel does CORPUS_SIZE ops per pass */
+
+static void bench_collision_circle_circle()
+{
+    Collision collision;
+    u32 hits = 0;
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        Obj *pair[2] = {&corpus.circles[i], &corpus.circles[(i + 1) % CORPUS_SIZE]};
+        hits += get_collision(pair, &collision);
+    }
+    sink = sink + (f32)hits;
+}
+
+static void bench_collision_rect_circle()
+{
+    Collision collision;
+    u32 hits = 0;
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        Obj *pair[2] = {&corpus.rects[i], &corpus.circles[i]};
+        hits += get_collision(pair, &collision);
+    }
+    sink = sink + (f32)hits;
+}
+
+static void bench_collision_rect_rect()
+{
+    Collision collision;
+    u32 hits = 0;
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        Obj *pair[2] = {&corpus.rects[i], &corpus.rects[(i + 1) % CORPUS_SIZE]};
+        hits += get_collision(pair, &collision);
+    }
+    sink = sink + (f32)hits;
+}
+
+static void bench_polys_colliding_sat()
+{
+    Collision collision;
+    u32 hits = 0;
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        u32 j = (i + 1) % CORPUS_SIZE;
+        Obj *objs[2] = {&corpus.rects[i], &corpus.rects[j]};
+        Vec2 *verts[2] = {corpus.rect_verts[i], corpus.rect_verts[j]};
+        u32 num_verts[2] = {4, 4};
+        hits += polys_colliding_sat(objs, verts, num_verts, &collision);
+    }
+    sink = sink + (f32)hits;
+}
+
+static void bench_get_rect_verts()
+{
+    Vec2 verts[4];
+    f32 sum = 0.0F;
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        get_rect_verts(&corpus.rects[i], verts);
+        sum += verts[0].x + verts[2].y;
+    }
+    sink = sink + sum;
+}
+
+static void bench_update_aabb_circle()
+{
+    f32 sum = 0.0F;
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        corpus.circles[i].update_aabb();
+        sum += corpus.circles[i].aabb.max.x;
+    }
+    sink = sink + sum;
+}
+
+static void bench_update_aabb_rect()
+{
+    f32 sum = 0.0F;
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        corpus.rects[i].update_aabb();
+        sum += corpus.rects[i].aabb.max.x;
+    }
+    sink = sink + sum;
+}
+
+static void bench_mat4_mul_mat4()
+{
+    f32 sum = 0.0F;
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        Mat4 m = corpus.mats[i] * corpus.mats[(i + 1) % CORPUS_SIZE];
+        sum += m.data[0] + m.data[13];
+    }
+    sink = sink + sum;
+}
+
+static void bench_mat4_mul_vec4()
+{
+    f32 sum = 0.0F;
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        Vec4 v = corpus.mats[i] * corpus.vec4s[i];
+        sum += v.x + v.w;
+    }
+    sink = sink + sum;
+}
+
+static void bench_vec2_normalized()
+{
+    f32 sum = 0.0F;
+    for (u32 i = 0; i < CORPUS_SIZE; ++i)
+    {
+        Vec2 v = corpus.vec2s[i].normalized();
+        sum += v.x + v.y;
+    }
+    sink = sink + sum;
+}
+
+struct Benchmark
+{
+    const char *name;
+    void (*pass)();
+};
+
+static Benchmark benchmarks[] = {
+    {"get_collision circle/circle", bench_collision_circle_circle},
+    {"get_collision rect/circle", bench_collision_rect_circle},
+    {"get_collision rect/rect", bench_collision_rect_rect},
+    {"polys_colliding_sat", bench_polys_colliding_sat},
+    {"get_rect_verts", bench_get_rect_verts},
+    {"Obj::update_aabb circle", bench_update_aabb_circle},
+    {"Obj::update_aabb rect", bench_update_aabb_rect},
+    {"Mat4 * Mat4", bench_mat4_mul_mat4},
+    {"Mat4 * Vec4", bench_mat4_mul_vec4},
+    {"Vec2::normalized", bench_vec2_normalized},
+};
+
+static int compare_u64(const void *a, const void *b)
+{
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+#define MAX_SAMPLES 1024
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [--seed <n>] [--samples <n>] [--min-time-ms <n>] [name filter]\n", name);
+}
+
+int main(int argc, char* args[])
+{
+    u32 seed = 1;
+    u32 num_samples = 51;
+    /* Each sample runs enough passes to take at least this long */
+    f64 min_sample_ms = 2.0;
+    const char *filter = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(args[i], "--seed") && i + 1 < argc)
+            seed = (u32)strtoul(args[++i], NULL, 0);
+        else if (!strcmp(args[i], "--samples") && i + 1 < argc)
+            num_samples = (u32)strtoul(args[++i], NULL, 0);
+        else if (!strcmp(args[i], "--min-time-ms") && i + 1 < argc)
+            min_sample_ms = atof(args[++i]);
+        else if (!filter && args[i][0] != '-')
+            filter = args[i];
+        else
+        {
+            print_usage(args[0]);
+            return 1;
+        }
+    }
+    num_samples = clamp((int)num_samples, 1, MAX_SAMPLES);
+
+    init_corpus(seed);
+
+    printf("seed %u, %u samples, corpus of %u\n", seed, num_samples, CORPUS_SIZE);
+    printf("%-30s %10s %10s %10s %12s\n", "kernel", "min ns/op", "med ns/op", "max ns/op", "Mops/s (med)");
+
+    for (u32 b = 0; b < SIZE_OF_ARRAY(benchmarks); ++b)
+    {
+        Benchmark *bench = &benchmarks[b];
+        if (filter && !strstr(bench->name, filter))
+            continue;
+
+        /* Warm up, and find how many passes make one sample */
+        u32 passes = 1;
+        while (true)
+        {
+            u64 start = get_time_ns();
+            for (u32 p = 0; p < passes; ++p)
+                bench->pass();
+            f64 ms = (f64)(get_time_ns() - start) / 1e6;
+            if (ms >= min_sample_ms || passes >= (1U << 20))
+                break;
+            passes *= 2;
+        }
+
+        u64 samples[MAX_SAMPLES];
+        for (u32 s = 0; s < num_samples; ++s)
+        {
+            u64 start = get_time_ns();
+            for (u32 p = 0; p < passes; ++p)
+                bench->pass();
+            samples[s] = get_time_ns() - start;
+        }
+        qsort(samples, num_samples, sizeof(samples[0]), compare_u64);
+
+        f64 ops = (f64)passes * CORPUS_SIZE;
+        f64 min_ns = (f64)samples[0] / ops;
+        f64 med_ns = (f64)samples[num_samples / 2] / ops;
+        f64 max_ns = (f64)samples[num_samples - 1] / ops;
+        printf("%-30s %10.2f %10.2f %10.2f %12.2f\n", bench->name, min_ns, med_ns, max_ns, 1e3 / med_ns);
+    }
+
+    return 0;
+}
@@ -0,0 +1,429 @@
+/*
+ * Captured frame encoding, shared by the platform layers
+ */
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+
+#include"frame_capture.h"
+
+// Frames that can be waiting for the encoder; more than this are dropped
+#define FRAME_CAPTURE_NUM_BUFFERS 8
+
+struct FrameCaptureBuffer
+{
+    u8* pixels;             // RGBA8, rows from the top
+    size_t size;            // allocated
+    int width;
+    int height;
+    u64 frame;
+};
+
+struct FrameCaptureEncoder
+{
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable freed;
+    bool stopping;
+
+    FrameCaptureBuffer buffers[FRAME_CAPTURE_NUM_BUFFERS];
+    // indices into buffers, each in exactly one of the two
+    u32 free[FRAME_CAPTURE_NUM_BUFFERS];
+    u32 num_free;
+    u32 queue[FRAME_CAPTURE_NUM_BUFFERS];   // ring, oldest at queue_first
+    u32 queue_first;
+    u32 queue_count;
+
+    // PNG encoding scratch, only used by the encoder thread
+    u8* filtered;
+    size_t filtered_size;
+    u8* deflated;
+    size_t deflated_size;
+};
+
+/*
+ * PNG
+ * Rows use the Up filter, so rows the same as the one above are all zeros, and the deflate
+ * stream only looks for repeats of the previous pixel. That's most of the compression a
+ * frame of flat colours has to give, for far less work than a general deflater
+ */
+
+static u32 crc_table[256];
+
+static void init_crc_table()
+{
+    for (u32 n = 0; n < 256; ++n)
+    {
+        u32 c = n;
+        for (int k = 0; k < 8; ++k)
+        {
+            c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+}
+
+static u32 update_crc(u32 crc, const u8* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void put_u32_be(u8* out, u32 value)
+{
+    out[0] = (u8)(value >> 24);
+    out[1] = (u8)(value >> 16);
+    out[2] = (u8)(value >> 8);
+    out[3] = (u8)value;
+}
+
+static void write_png_chunk(FILE* file, const char* type, const u8* data, u32 size)
+{
+    u8 header[8];
+    put_u32_be(header, size);
+    memcpy(header + 4, type, 4);
+    u32 crc = update_crc(0xFFFFFFFF, header + 4, 4);
+    crc = update_crc(crc, data, size) ^ 0xFFFFFFFF;
+    u8 footer[4];
+    put_u32_be(footer, crc);
+    fwrite(header, 1, sizeof(header), file);
+    fwrite(data, 1, size, file);
+    fwrite(footer, 1, sizeof(footer), file);
+}
+
+// Deflate bits go in from the least significant end
+struct BitWriter
+{
+    u8* out;
+    size_t pos;
+    u64 bits;
+    u32 num_bits;
+};
+
+static void put_bits(BitWriter* writer, u32 value, u32 num_bits)
+{
+    writer->bits |= (u64)value << writer->num_bits;
+    writer->num_bits += num_bits;
+    while (writer->num_bits >= 8)
+    {
+        writer->out[writer->pos++] = (u8)writer->bits;
+        writer->bits >>= 8;
+        writer->num_bits -= 8;
+    }
+}
+
+/* Huffman codes are written from their most significant bit */
+static void put_code(BitWriter* writer, u32 code, u32 num_bits)
+{
+    u32 reversed = 0;
+    for (u32 i = 0; i < num_bits; ++i)
+    {
+        reversed |= ((code >> i) & 1) << (num_bits - 1 - i);
+    }
+    put_bits(writer, reversed, num_bits);
+}
+
+/* Literal/length symbol with deflate's fixed Huffman codes */
+static void put_fixed_symbol(BitWriter* writer, u32 symbol)
+{
+    if (symbol < 144)
+        put_code(writer, 0x30 + symbol, 8);
+    else if (symbol < 256)
+        put_code(writer, 0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        put_code(writer, symbol - 256, 7);
+    else
+        put_code(writer, 0xC0 + symbol - 280, 8);
+}
+
+static const u16 LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const u8 LENGTH_EXTRA_BITS[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/* A zlib stream of data, as one fixed Huffman block. Returns its size */
+static size_t deflate_repeats(const u8* data, size_t size, u8* out)
+{
+    BitWriter writer = {out, 0, 0, 0};
+    // zlib header: deflate with a 32K window, no dictionary, fastest
+    put_bits(&writer, 0x78, 8);
+    put_bits(&writer, 0x01, 8);
+    put_bits(&writer, 1, 1);    // last block
+    put_bits(&writer, 1, 2);    // fixed Huffman codes
+
+    const size_t DISTANCE = 4;  // one pixel back
+    size_t i = 0;
+    while (i < size)
+    {
+        size_t length = 0;
+        if (i >= DISTANCE)
+        {
+            while (length < 258 && i + length < size && data[i + length] == data[i + length - DISTANCE])
+            {
+                length++;
+            }
+        }
+        if (length < 3)
+        {
+            put_fixed_symbol(&writer, data[i]);
+            i++;
+            continue;
+        }
+
+        int code = 28;
+        while (LENGTH_BASE[code] > length)
+        {
+            code--;
+        }
+        put_fixed_symbol(&writer, 257 + code);
+        put_bits(&writer, (u32)(length - LENGTH_BASE[code]), LENGTH_EXTRA_BITS[code]);
+        put_code(&writer, 3, 5);    // distance 4, no extra bits
+        i += length;
+    }
+    put_fixed_symbol(&writer, 256);    // end of block
+    put_bits(&writer, 0, 7);    // pad to a byte
+
+    u32 a = 1;
+    u32 b = 0;
+    for (size_t j = 0; j < size; ++j)
+    {
+        a = (a + data[j]) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_u32_be(out + writer.pos, (b << 16) | a);
+    return writer.pos + 4;
+}
+
+static void ensure_size(u8** buffer, size_t* allocated, size_t size)
+{
+    if (size > *allocated)
+    {
+        free(*buffer);
+        *buffer = (u8*)malloc(size);
+        if (!*buffer)
+        {
+            FATAL_PRINTF("Couldn't allocate %llu bytes for frame capture\n", (unsigned long long)size);
+        }
+        *allocated = size;
+    }
+}
+
+static void write_png(FrameCapture* capture, FrameCaptureBuffer* buffer)
+{
+    FrameCaptureEncoder* encoder = capture->encoder;
+    size_t row_size = (size_t)buffer->width * 4;
+    size_t filtered_size = (row_size + 1) * buffer->height;
+    ensure_size(&encoder->filtered, &encoder->filtered_size, filtered_size);
+    // fixed codes are at most 9 bits a byte
+    ensure_size(&encoder->deflated, &encoder->deflated_size, filtered_size + filtered_size / 8 + 64);
+
+    for (int y = 0; y < buffer->height; ++y)
+    {
+        u8* out = encoder->filtered + y * (row_size + 1);
+        const u8* row = buffer->pixels + y * row_size;
+        if (y == 0)
+        {
+            out[0] = 0;     // None
+            memcpy(out + 1, row, row_size);
+            continue;
+        }
+        out[0] = 2;     // Up
+        const u8* above = row - row_size;
+        for (size_t x = 0; x < row_size; ++x)
+        {
+            out[1 + x] = (u8)(row[x] - above[x]);
+        }
+    }
+    size_t deflated_size = deflate_repeats(encoder->filtered, filtered_size, encoder->deflated);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s%06llu.png", capture->path, (unsigned long long)buffer->frame);
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        DEBUG_PRINTF("Couldn't open \"%s\" for frame capture\n", path);
+        return;
+    }
+    static const u8 PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(PNG_SIGNATURE, 1, sizeof(PNG_SIGNATURE), file);
+    u8 header[13];
+    put_u32_be(header, buffer->width);
+    put_u32_be(header + 4, buffer->height);
+    header[8] = 8;      // bits per channel
+    header[9] = 6;      // RGBA
+    header[10] = 0;     // deflate
+    header[11] = 0;     // adaptive filtering
+    header[12] = 0;     // not interlaced
+    write_png_chunk(file, "IHDR", header, sizeof(header));
+    write_png_chunk(file, "IDAT", encoder->deflated, (u32)deflated_size);
+    write_png_chunk(file, "IEND", NULL, 0);
+    fclose(file);
+}
+
+static void encode_frames(FrameCapture* capture)
+{
+    FrameCaptureEncoder* encoder = capture->encoder;
+    for (;;)
+    {
+        u32 index;
+        {
+            std::unique_lock<std::mutex> lock(encoder->mutex);
+            encoder->queued.wait(lock, [&]{ return encoder->queue_count || encoder->stopping; });
+            if (!encoder->queue_count)
+                return;
+            index = encoder->queue[encoder->queue_first];
+        }
+
+        FrameCaptureBuffer* buffer = &encoder->buffers[index];
+        if (capture->format == FRAME_CAPTURE_RAW)
+        {
+            fwrite(buffer->pixels, (size_t)buffer->width * 4, buffer->height, capture->raw_file);
+        }
+        else
+        {
+            write_png(capture, buffer);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(encoder->mutex);
+            encoder->queue_first = (encoder->queue_first + 1) % FRAME_CAPTURE_NUM_BUFFERS;
+            encoder->queue_count--;
+            encoder->free[encoder->num_free++] = index;
+        }
+        encoder->freed.notify_one();
+    }
+}
+
+bool frame_capture_begin(FrameCapture* capture, const char* path)
+{
+    capture->encoder = NULL;
+    size_t path_len = strlen(path);
+    capture->format = path_len >= 4 && !strcmp(path + path_len - 4, ".raw") ? FRAME_CAPTURE_RAW : FRAME_CAPTURE_PNG;
+    capture->path = path;
+    capture->raw_file = NULL;
+    capture->width = 0;
+    capture->height = 0;
+    capture->num_frames = 0;
+    capture->num_dropped = 0;
+    capture->wait_for_buffers = false;
+    if (capture->format == FRAME_CAPTURE_RAW)
+    {
+        capture->raw_file = fopen(path, "wb");
+        if (!capture->raw_file)
+        {
+            DEBUG_PRINTF("Couldn't open \"%s\" for frame capture\n", path);
+            return false;
+        }
+    }
+    init_crc_table();
+
+    FrameCaptureEncoder* encoder = new FrameCaptureEncoder();
+    encoder->stopping = false;
+    for (u32 i = 0; i < FRAME_CAPTURE_NUM_BUFFERS; ++i)
+    {
+        encoder->free[i] = i;
+    }
+    encoder->num_free = FRAME_CAPTURE_NUM_BUFFERS;
+    encoder->queue_first = 0;
+    encoder->queue_count = 0;
+    capture->encoder = encoder;
+    encoder->thread = std::thread(encode_frames, capture);
+
+    DEBUG_PRINTF("Capturing frames to \"%s\"\n", path);
+    return true;
+}
+
+void frame_capture_add(void* _capture, const u8* first_row, s64 row_stride, int width, int height)
+{
+    FrameCapture* capture = (FrameCapture*)_capture;
+    FrameCaptureEncoder* encoder = capture->encoder;
+    if (!capture->width)
+    {
+        capture->width = width;
+        capture->height = height;
+    }
+    // a raw video stream can't change size
+    if (capture->format == FRAME_CAPTURE_RAW && (width != capture->width || height != capture->height))
+    {
+        capture->num_dropped++;
+        return;
+    }
+
+    u32 index;
+    {
+        std::unique_lock<std::mutex> lock(encoder->mutex);
+        if (capture->wait_for_buffers)
+        {
+            encoder->freed.wait(lock, [&]{ return encoder->num_free != 0; });
+        }
+        if (!encoder->num_free)
+        {
+            capture->num_dropped++;
+            return;
+        }
+        index = encoder->free[--encoder->num_free];
+    }
+
+    // copied outside the lock, the encoder only sees the buffer once it's queued
+    FrameCaptureBuffer* buffer = &encoder->buffers[index];
+    size_t row_size = (size_t)width * 4;
+    ensure_size(&buffer->pixels, &buffer->size, row_size * height);
+    for (int y = 0; y < height; ++y)
+    {
+        memcpy(buffer->pixels + y * row_size, first_row + y * row_stride, row_size);
+    }
+    buffer->width = width;
+    buffer->height = height;
+    buffer->frame = capture->num_frames++;
+
+    {
+        std::lock_guard<std::mutex> lock(encoder->mutex);
+        encoder->queue[(encoder->queue_first + encoder->queue_count) % FRAME_CAPTURE_NUM_BUFFERS] = index;
+        encoder->queue_count++;
+    }
+    encoder->queued.notify_one();
+}
+
+void frame_capture_drop(FrameCapture* capture)
+{
+    capture->num_dropped++;
+}
+
+void frame_capture_end(FrameCapture* capture)
+{
+    FrameCaptureEncoder* encoder = capture->encoder;
+    if (!encoder)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(encoder->mutex);
+        encoder->stopping = true;
+    }
+    encoder->queued.notify_one();
+    encoder->thread.join();
+
+    printf("captured %llu frames to \"%s\", dropped %llu\n",
+           (unsigned long long)capture->num_frames, capture->path, (unsigned long long)capture->num_dropped);
+    if (capture->format == FRAME_CAPTURE_RAW)
+    {
+        fclose(capture->raw_file);
+        printf("convert with: ffmpeg -f rawvideo -pix_fmt rgba -s %dx%d -r 60 -i %s out.mp4\n",
+               capture->width, capture->height, capture->path);
+    }
+
+    for (u32 i = 0; i < FRAME_CAPTURE_NUM_BUFFERS; ++i)
+    {
+        free(encoder->buffers[i].pixels);
+    }
+    free(encoder->filtered);
+    free(encoder->deflated);
+    delete encoder;
+    capture->encoder = NULL;
+}
@@ -0,0 +1,117 @@
+/*
+ * Absolute deadline frame pacing, see frame_pacer.h
+ */
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<time.h>
+#include<errno.h>
+#endif
+
+#include"frame_pacer.h"
+
+/* Bounds for the spin after the sleep */
+#define MIN_SPIN_NS 20000ULL
+#define MAX_SPIN_NS 2000000ULL
+
+u64 frame_pacer_time_ns()
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (u64)((f64)counter.QuadPart * 1e9 / (f64)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+#endif
+}
+
+/* OS sleep until about wake_ns, on the frame_pacer_time_ns clock */
+static void sleep_until(FramePacer* pacer, u64 wake_ns)
+{
+#ifdef _WIN32
+    u64 now = frame_pacer_time_ns();
+    if (wake_ns <= now)
+        return;
+    /* relative, in 100ns units */
+    LARGE_INTEGER due;
+    due.QuadPart = -(LONGLONG)((wake_ns - now) / 100);
+    if (pacer->timer && SetWaitableTimer((HANDLE)pacer->timer, &due, 0, NULL, NULL, FALSE))
+    {
+        WaitForSingleObject((HANDLE)pacer->timer, INFINITE);
+    }
+    else
+    {
+        Sleep((DWORD)((wake_ns - now) / 1000000));
+    }
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(wake_ns / 1000000000ULL);
+    ts.tv_nsec = (long)(wake_ns % 1000000000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+#endif
+}
+
+void frame_pacer_init(FramePacer* pacer, u64 period_ns)
+{
+    pacer->period_ns = period_ns;
+    pacer->deadline_ns = frame_pacer_time_ns() + period_ns;
+    pacer->spin_ns = MAX_SPIN_NS / 2;
+    pacer->timer = NULL;
+#ifdef _WIN32
+#ifdef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+    pacer->timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+    if (!pacer->timer)
+    {
+        pacer->timer = CreateWaitableTimerW(NULL, TRUE, NULL);
+    }
+#endif
+}
+
+bool frame_pacer_wait(FramePacer* pacer, u64* overshoot_ns)
+{
+    u64 deadline = pacer->deadline_ns;
+    u64 now = frame_pacer_time_ns();
+    bool waited = now < deadline;
+
+    if (now + pacer->spin_ns < deadline)
+    {
+        u64 wake = deadline - pacer->spin_ns;
+        sleep_until(pacer, wake);
+        now = frame_pacer_time_ns();
+
+        /* grow the spin right away when a sleep runs late, shrink it slowly otherwise */
+        u64 late = now > wake ? now - wake : 0;
+        u64 spin = late > pacer->spin_ns ? late + late / 4 : pacer->spin_ns - pacer->spin_ns / 64;
+        pacer->spin_ns = spin < MIN_SPIN_NS ? MIN_SPIN_NS : spin > MAX_SPIN_NS ? MAX_SPIN_NS : spin;
+    }
+    while (now < deadline)
+    {
+        now = frame_pacer_time_ns();
+    }
+
+    *overshoot_ns = now - deadline;
+    pacer->deadline_ns += pacer->period_ns;
+    /* after a long frame, start over from now rather than rushing frames to catch up */
+    if (pacer->deadline_ns < now)
+    {
+        pacer->deadline_ns = now + pacer->period_ns;
+    }
+    return waited;
+}
+
+void frame_pacer_end(FramePacer* pacer)
+{
+#ifdef _WIN32
+    if (pacer->timer)
+    {
+        CloseHandle((HANDLE)pacer->timer);
+    }
+#endif
+    pacer->timer = NULL;
+}
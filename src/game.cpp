@@ -4,6 +4,11 @@
 #include"game_platform_interface.h"
 #include"game.h"
 #include"rendering.h"
+#include"scene_file.h"
+#include"scene_gen.h"
+#include"profiler.h"
+#include"trace.h"
+#include"stats_log.h"
 
 Color background_color = Color{0.4F, 0.4F, 0.4F, 1.0F};
 Color grid_color = Color{0.2F, 0.2F, 0.2F, 1.0F};
@@ -13,6 +18,55 @@ Color aabb_color = Color{1.0F,0.0F,0.0F,1.0F};
 
 #define GRID_SPACING 0.1F
 
+/* Physics stats, see stats_log.h */
+static StatsLog stats_log;
+static u32 stats_frame;
+static u32 num_collision_tests;
+
+static f32 camera_zoom(GameState* game_state)
+{
+    return exp2f((f32)game_state->camera_zoom_steps / (f32)CAMERA_ZOOM_STEPS_PER_DOUBLING);
+}
+
+/* The part of the game the camera sees, which is 2 / zoom game units across */
+static AABB camera_view(Vec2 camera_pos, f32 zoom)
+{
+    Vec2 half_size = Vec2(1.0F, 1.0F) / zoom;
+    return AABB{camera_pos - half_size, camera_pos + half_size};
+}
+
+/*
+ * Wheel zooms in and out around the mouse pointer, and dragging with the right or middle
+ * button pans. mouse_view_pos is the mouse in view coords, from -1 to 1 across the viewport
+ */
+static void update_camera(GameState* game_state, GameInputBuffer* input_buffer, Vec2 mouse_view_pos)
+{
+    GameInput* last_input = input_buffer->last_input();
+    GameInput* prev_input = input_buffer->prev_frame_input(1);
+
+    s32 scrolled = last_input->mouse_wheel_scrolled - prev_input->mouse_wheel_scrolled;
+    if (scrolled)
+    {
+        Vec2 mouse_game_pos = game_state->camera_pos + mouse_view_pos / camera_zoom(game_state);
+        game_state->camera_zoom_steps = MIN(MAX(game_state->camera_zoom_steps + scrolled, CAMERA_MIN_ZOOM_STEPS), CAMERA_MAX_ZOOM_STEPS);
+        game_state->camera_pos = mouse_game_pos - mouse_view_pos / camera_zoom(game_state);
+    }
+
+    if (last_input->mouse_right_down || last_input->mouse_middle_down)
+    {
+        if (!game_state->camera_dragging)
+        {
+            game_state->camera_dragging = true;
+            game_state->camera_grab_pos = game_state->camera_pos + mouse_view_pos / camera_zoom(game_state);
+        }
+        game_state->camera_pos = game_state->camera_grab_pos - mouse_view_pos / camera_zoom(game_state);
+    }
+    else
+    {
+        game_state->camera_dragging = false;
+    }
+}
+
 bool AABB::intersects(AABB other)
 {
     if (this->min.x > other.max.x || this->max.x < other.min.x)
@@ -169,6 +223,7 @@ bool polys_colliding_sat(Obj *objs[2], Vec2 *verts[2], u32 num_verts[2], Collisi
 
 bool get_collision(Obj **pair, Collision *collision)
 {
+    num_collision_tests++;
     Obj *obj_pair[2] = {pair[0], pair[1]};
     /* Order by shape, i.e. swap if circle is first in the pair */
     if (obj_pair[1]->shape == Obj::Rect)
@@ -282,46 +337,120 @@ void integrate_from_old_pos_rot(Obj *obj, f32 dt)
     obj->rot = obj->old_rot + obj->alpha * dt;
 }
 
-void game_update_and_render(GameMemory* game_memory, GameInputBuffer* input_buffer, GameRenderInfo* render_info)
+/* Copies only the bodies in use; game states are mostly empty space */
+void copy_game_state(GameState *dst, GameState *src)
+{
+    u32 old_num_objs = dst->num_objs;
+    memcpy((void*)dst, src, offsetof(GameState, objs) + src->num_objs * sizeof(Obj));
+    if (old_num_objs > src->num_objs)
+    {
+        memset((void*)&dst->objs[src->num_objs], 0, (old_num_objs - src->num_objs) * sizeof(Obj));
+    }
+}
+
+void clear_game_state(GameState *game_state)
+{
+    memset((void*)&game_state->objs[0], 0, game_state->num_objs * sizeof(Obj));
+    memset((void*)game_state, 0, offsetof(GameState, objs));
+}
+
+bool load_scene(GameState *game_state, const char *filename)
+{
+    s64 size;
+    void *data = DEBUG_platform_map_file(filename, &size);
+    if (!data)
+        return false;
+
+    u32 num_objs;
+    Obj *objs = scene_file_objs(data, size, &num_objs);
+    if (!objs || num_objs > MAX_OBJS)
+    {
+        if (objs)
+            DEBUG_PRINTF("Scene has %u bodies, max is %u\n", num_objs, MAX_OBJS);
+        DEBUG_platform_unmap_file(data, size);
+        return false;
+    }
+
+    clear_game_state(game_state);
+    memcpy((void*)game_state->objs, objs, num_objs * sizeof(Obj));
+    game_state->num_objs = num_objs;
+
+    DEBUG_platform_unmap_file(data, size);
+    DEBUG_PRINTF("Loaded %u bodies from \"%s\"\n", num_objs, filename);
+    return true;
+}
+
+static void simulate(GameMemoryBlock* block, GameInputBuffer* input_buffer)
 {
-    GameMemoryBlock* block = (GameMemoryBlock*)(game_memory->memory);
     GameState* game_state = block->game_state;
 
     f32 dt = input_buffer->dt;
 
-    game_state->camera_pos = Vec2();
+    profiler_begin_frame();
+    u32 frame = stats_frame++;
 
     GameInput *last_input = input_buffer->last_input();
 
-    /* switch between game states */
-    if (last_input->_1 && !input_buffer->prev_frame_input(1)->_1)
+    if (last_input->f1 && !input_buffer->prev_frame_input(1)->f1)
     {
-        block->curr_state_i = 0;
-        block->game_state = &block->game_states[block->curr_state_i];
-        return;
+        profiler_toggle_overlay();
     }
-    if (last_input->_2 && !input_buffer->prev_frame_input(1)->_2)
+    if (last_input->f2 && !input_buffer->prev_frame_input(1)->f2)
     {
-        block->curr_state_i = 1;
-        block->game_state = &block->game_states[block->curr_state_i];
-        return;
+        if (trace_active())
+        {
+            trace_end();
+        }
+        else
+        {
+            /* numbered so that captures in one run don't overwrite each other */
+            static u32 trace_num = 0;
+            char trace_filename[32];
+            snprintf(trace_filename, sizeof(trace_filename), "trace_%u.json", trace_num++);
+            trace_begin(trace_filename);
+        }
     }
-    if (last_input->_3 && !input_buffer->prev_frame_input(1)->_3)
+
+    /* switch between game states */
+    bool number_keys[GAME_NUM_SCENE_SLOTS] = {
+        last_input->_1 && !input_buffer->prev_frame_input(1)->_1,
+        last_input->_2 && !input_buffer->prev_frame_input(1)->_2,
+        last_input->_3 && !input_buffer->prev_frame_input(1)->_3,
+        last_input->_4 && !input_buffer->prev_frame_input(1)->_4,
+        last_input->_5 && !input_buffer->prev_frame_input(1)->_5,
+        last_input->_6 && !input_buffer->prev_frame_input(1)->_6,
+        last_input->_7 && !input_buffer->prev_frame_input(1)->_7,
+        last_input->_8 && !input_buffer->prev_frame_input(1)->_8,
+        last_input->_9 && !input_buffer->prev_frame_input(1)->_9,
+        last_input->_0 && !input_buffer->prev_frame_input(1)->_0,
+    };
+    for (u32 i = 0; i < GAME_NUM_SCENE_SLOTS; ++i)
     {
-        block->curr_state_i = 2;
-        block->game_state = &block->game_states[block->curr_state_i];
-        return;
+        if (number_keys[i])
+        {
+            block->curr_state_i = i;
+            block->game_state = &block->game_states[block->curr_state_i];
+            block->num_collisions = 0;
+            block->static_version++;
+            return;
+        }
     }
     /* reset current game state */
     if (last_input->r && !input_buffer->prev_frame_input(1)->r)
     {
-        memcpy(game_state, &block->initial_game_states[block->curr_state_i], sizeof(GameState));
+        copy_game_state(game_state, &block->initial_game_states[block->curr_state_i]);
+        block->num_collisions = 0;
+        block->static_version++;
         return;
     }
 
     /* mouse force */
     bool mouse_force_on = false;
-    Vec2 mouse_pos = rendering_window_pos_to_viewport_pos(last_input->mouse_x, last_input->mouse_y);
+    /* the simulation may not be on the render thread, so this doesn't ask the renderer for its viewport */
+    RenderViewport viewport = RenderViewport::fit_to_window(last_input->window_width, last_input->window_height);
+    Vec2 mouse_view_pos = viewport.window_pos_to_viewport_pos(last_input->mouse_x, last_input->mouse_y);
+    update_camera(game_state, input_buffer, mouse_view_pos);
+    Vec2 mouse_pos = game_state->camera_pos + mouse_view_pos / camera_zoom(game_state);
     bool mouse_released = false;
     if (last_input->mouse_left_down)
     {
@@ -369,49 +498,57 @@ void game_update_and_render(GameMemory* game_memory, GameInputBuffer* input_buff
     /* slow down */
     dt *= 0.8F;
 
-    for (int i = 0; i < MAX_OBJS; ++i)
-    {
-        Obj *obj = &objs[i];
-        if (!obj->exists || obj->is_static)
-            continue;
+    u32 num_objs = game_state->num_objs;
 
-        /* Compute forces */
-        obj->torque = 0.0F;
-        obj->force = Vec2{0.0F, 0.0F};
-        /* Gravity */
-        //obj->force = obj->force + Vec2(0, -9.81F);
-        /* Mouse force */
-        Vec2 mouse_to_obj = obj->pos - mouse_pos;
-        /* TODO this check is hacky, redo */
-        f32 radius_mouse_check = obj->shape == Obj::Rect ? MAX(obj->width, obj->height) / 2.0F : obj->radius;
-        if (mouse_to_obj.length() < radius_mouse_check)
+    {
+        PROFILE_SCOPE(PROFILE_FORCES);
+        for (u32 i = 0; i < num_objs; ++i)
         {
-            mouse_force_on = true;
-            if (mouse_released)
+            Obj *obj = &objs[i];
+            if (!obj->exists || obj->is_static)
+                continue;
+
+            /* Compute forces */
+            obj->torque = 0.0F;
+            obj->force = Vec2{0.0F, 0.0F};
+            /* Gravity */
+            //obj->force = obj->force + Vec2(0, -9.81F);
+            /* Mouse force */
+            Vec2 mouse_to_obj = obj->pos - mouse_pos;
+            /* TODO this check is hacky, redo */
+            f32 radius_mouse_check = obj->shape == Obj::Rect ? MAX(obj->width, obj->height) / 2.0F : obj->radius;
+            if (mouse_to_obj.length() < radius_mouse_check)
             {
-                /* scale length on constant factor */
-                f32 m_force_scale = 100.0F;
-                Vec2 m_force = mouse_pos - game_state->mouse_force_origin;
-                DEBUG_PRINTF("mouse_pos = Vec2(%.16fF, %.16fF);\n", mouse_pos.x, mouse_pos.y);
-                DEBUG_PRINTF("game_state->mouse_force_origin = Vec2(%.16fF, %.16fF);\n", game_state->mouse_force_origin.x, game_state->mouse_force_origin.y);
-                m_force = m_force * m_force_scale;
-                Vec2 obj_to_mouse = mouse_to_obj * -1.0F;
-                obj->torque = obj->torque + (obj_to_mouse.x * m_force.y - obj_to_mouse.y * m_force.x);
-                obj->force = obj->force + m_force;
+                mouse_force_on = true;
+                if (mouse_released)
+                {
+                    /* scale length on constant factor */
+                    f32 m_force_scale = 100.0F;
+                    Vec2 m_force = mouse_pos - game_state->mouse_force_origin;
+                    DEBUG_PRINTF("mouse_pos = Vec2(%.16fF, %.16fF);\n", mouse_pos.x, mouse_pos.y);
+                    DEBUG_PRINTF("game_state->mouse_force_origin = Vec2(%.16fF, %.16fF);\n", game_state->mouse_force_origin.x, game_state->mouse_force_origin.y);
+                    m_force = m_force * m_force_scale;
+                    Vec2 obj_to_mouse = mouse_to_obj * -1.0F;
+                    obj->torque = obj->torque + (obj_to_mouse.x * m_force.y - obj_to_mouse.y * m_force.x);
+                    obj->force = obj->force + m_force;
+                }
             }
-        }
 
-        integrate_vel_alpha(obj, dt);
-        /* save old pos and rot */
-        obj->old_pos = obj->pos;
-        obj->old_rot = obj->rot;
-        obj->dt = dt;
-        integrate_from_old_pos_rot(obj, dt);
+            integrate_vel_alpha(obj, dt);
+            /* save old pos and rot */
+            obj->old_pos = obj->pos;
+            obj->old_rot = obj->rot;
+            obj->dt = dt;
+            integrate_from_old_pos_rot(obj, dt);
+        }
     }
 
     /* Detect collisions and move stuff back so it's not actually colliding */
     u32 coll_num = 0;
-    Collision *collision = &game_state->collisions[coll_num];
+    u32 collision_tests_start = num_collision_tests;
+    u32 pairs_total = 0;
+    u32 invariant_failures = 0;
+    Collision *collision = &block->collisions[coll_num];
     u32 iter = 0;
     u32 colls_this_iter = 0;
     do
@@ -419,350 +556,605 @@ void game_update_and_render(GameMemory* game_memory, GameInputBuffer* input_buff
         colls_this_iter = 0;
         /* physics - collision detection */
         /* broad phase - compute AABBs */
-        for (int i = 0; i < MAX_OBJS; ++i)
         {
-            Obj *obj = &objs[i];
-            if (!obj->exists || obj->is_static)
-                continue;
-            obj->update_aabb();
+            PROFILE_SCOPE(PROFILE_AABB);
+            for (u32 i = 0; i < num_objs; ++i)
+            {
+                Obj *obj = &objs[i];
+                if (!obj->exists || obj->is_static)
+                    continue;
+                obj->update_aabb();
+            }
         }
         /* broad phase - produce pairs of potentially colliding objects */
         /* brute forceee */
         u32 p_coll_num = 0;
-        for (int i = 0; i < MAX_OBJS; ++i)
         {
-            Obj *objA = &objs[i];
-            if (!objA->exists)
-                continue;
-            for (int j = i + 1; j < MAX_OBJS; ++j)
+            PROFILE_SCOPE(PROFILE_BROAD);
+            for (u32 i = 0; i < num_objs && p_coll_num < MAX_COLL_PAIRS; ++i)
             {
-                Obj *objB = &objs[j];
-                if (!objB->exists)
+                Obj *objA = &objs[i];
+                if (!objA->exists)
                     continue;
-                if (objA->is_static && objB->is_static)
-                    continue;
-                if (objA->aabb.intersects(objB->aabb))
+                for (u32 j = i + 1; j < num_objs && p_coll_num < MAX_COLL_PAIRS; ++j)
                 {
-                    game_state->p_coll_pairs[p_coll_num][0] = objA;
-                    game_state->p_coll_pairs[p_coll_num][1] = objB;
-                    p_coll_num++;
+                    Obj *objB = &objs[j];
+                    if (!objB->exists)
+                        continue;
+                    if (objA->is_static && objB->is_static)
+                        continue;
+                    if (objA->aabb.intersects(objB->aabb))
+                    {
+                        block->p_coll_pairs[p_coll_num][0] = objA;
+                        block->p_coll_pairs[p_coll_num][1] = objB;
+                        p_coll_num++;
+                    }
                 }
             }
         }
+        if (p_coll_num == MAX_COLL_PAIRS)
+        {
+            DEBUG_PRINTF("Too many potential collision pairs, dropping some\n");
+        }
+        TRACE_COUNTER(TRACE_PAIRS, p_coll_num);
+        pairs_total += p_coll_num;
         /* narrow phase - produce pairs of colliding objects */
-        for (u32 i = 0; i < p_coll_num; ++i)
         {
-            Obj **obj_pair = game_state->p_coll_pairs[i];
-
-            if (!get_collision(obj_pair, collision))
-                continue;
-
-            // TODO compute dist between collision points; using dt is...hmm maybe its ok?
-            /*
-            * This pair is colliding
-            * They may have different dts
-            * We must use the earlier dt as the max dt
-            * Otherwise we undo previous work
-            */
-            // TODO actually, should iterate on obj with max dt of the two, until it's dt == other obj's dt, then do both at once as here
-            f32 max_dt = MIN(obj_pair[0]->dt, obj_pair[1]->dt);
-            if (obj_pair[0]->is_static)
-                max_dt = obj_pair[1]->dt;
-            else if (obj_pair[1]->is_static)
-                max_dt = obj_pair[0]->dt;
-            /* reset to 0 */
-            if (!obj_pair[0]->is_static)
-                integrate_from_old_pos_rot(obj_pair[0], 0.0F);
-            if (!obj_pair[1]->is_static)
-                integrate_from_old_pos_rot(obj_pair[1], 0.0F);
-
-            f32 curr_dt = 0.0F;
-            f32 step_dt = max_dt;
-            f32 threshold = dt / 16.0F; /* independent of max_dt */
-            bool c = get_collision(obj_pair, collision);
-            if (c)
+            PROFILE_SCOPE(PROFILE_NARROW);
+            for (u32 i = 0; i < p_coll_num; ++i)
             {
-                DEBUG_PRINTF("Invariant broken - colliding at start of frame: iter(%u)\n", iter);
-                game_state->paused = true;
-                break;
-            }
-            while (true) {
-                /* Not colliding here - integrate forward to find collision */
-                do
+                Obj **obj_pair = block->p_coll_pairs[i];
+
+                if (coll_num == MAX_COLL_PAIRS - 1)
                 {
-                    if (step_dt > threshold)
-                        step_dt /= 2.0F;
-                    else
-                        break;
+                    DEBUG_PRINTF("Too many collisions, ignoring the rest\n");
+                    break;
+                }
+                if (!get_collision(obj_pair, collision))
+                    continue;
+                /* the rest of this iteration is the time of impact search */
+                PROFILE_SCOPE(PROFILE_TOI);
+
+                // TODO compute dist between collision points; using dt is...hmm maybe its ok?
+                /*
+                * This pair is colliding
+                * They may have different dts
+                * We must use the earlier dt as the max dt
+                * Otherwise we undo previous work
+                */
+                // TODO actually, should iterate on obj with max dt of the two, until it's dt == other obj's dt, then do both at once as here
+                f32 max_dt = MIN(obj_pair[0]->dt, obj_pair[1]->dt);
+                if (obj_pair[0]->is_static)
+                    max_dt = obj_pair[1]->dt;
+                else if (obj_pair[1]->is_static)
+                    max_dt = obj_pair[0]->dt;
+                /* reset to 0 */
+                if (!obj_pair[0]->is_static)
+                    integrate_from_old_pos_rot(obj_pair[0], 0.0F);
+                if (!obj_pair[1]->is_static)
+                    integrate_from_old_pos_rot(obj_pair[1], 0.0F);
+
+                f32 curr_dt = 0.0F;
+                f32 step_dt = max_dt;
+                f32 threshold = dt / 16.0F; /* independent of max_dt */
+                bool c = get_collision(obj_pair, collision);
+                if (c)
+                {
+                    DEBUG_PRINTF("Invariant broken - colliding at start of frame: iter(%u)\n", iter);
+                    invariant_failures++;
+                    game_state->paused = true;
+                    break;
+                }
+                while (true) {
+                    /* Not colliding here - integrate forward to find collision */
+                    do
+                    {
+                        if (step_dt > threshold)
+                            step_dt /= 2.0F;
+                        else
+                            break;
 
-                    curr_dt = MIN(curr_dt + step_dt, max_dt);
-                    if (!obj_pair[0]->is_static)
-                        integrate_from_old_pos_rot(obj_pair[0], curr_dt);
-                    if (!obj_pair[1]->is_static)
-                        integrate_from_old_pos_rot(obj_pair[1], curr_dt);
+                        curr_dt = MIN(curr_dt + step_dt, max_dt);
+                        if (!obj_pair[0]->is_static)
+                            integrate_from_old_pos_rot(obj_pair[0], curr_dt);
+                        if (!obj_pair[1]->is_static)
+                            integrate_from_old_pos_rot(obj_pair[1], curr_dt);
 
-                } while (!get_collision(obj_pair, collision));
+                    } while (!get_collision(obj_pair, collision));
 
-                /* Colliding here - integrate backward to find non-collision */
-                do
-                {
-                    if (step_dt > threshold)
-                        step_dt /= 2.0F;
+                    /* Colliding here - integrate backward to find non-collision */
+                    do
+                    {
+                        if (step_dt > threshold)
+                            step_dt /= 2.0F;
 
-                    curr_dt = MAX(curr_dt - step_dt, 0.0F);
-                    if (!obj_pair[0]->is_static)
-                        integrate_from_old_pos_rot(obj_pair[0], curr_dt);
-                    if (!obj_pair[1]->is_static)
-                        integrate_from_old_pos_rot(obj_pair[1], curr_dt);
+                        curr_dt = MAX(curr_dt - step_dt, 0.0F);
+                        if (!obj_pair[0]->is_static)
+                            integrate_from_old_pos_rot(obj_pair[0], curr_dt);
+                        if (!obj_pair[1]->is_static)
+                            integrate_from_old_pos_rot(obj_pair[1], curr_dt);
 
-                } while (get_collision(obj_pair, collision));
+                    } while (get_collision(obj_pair, collision));
 
-                if (step_dt <= threshold)
-                    break;
-            }
+                    if (step_dt <= threshold)
+                        break;
+                }
 
-            obj_pair[0]->dt = curr_dt;
-            obj_pair[1]->dt = curr_dt;
-            colls_this_iter++;
-            coll_num++;
-            collision = &game_state->collisions[coll_num];
+                obj_pair[0]->dt = curr_dt;
+                obj_pair[1]->dt = curr_dt;
+                colls_this_iter++;
+                coll_num++;
+                collision = &block->collisions[coll_num];
+            }
         }
         iter++;
     } while (colls_this_iter);
+    TRACE_COUNTER(TRACE_COLLISIONS, coll_num);
+    TRACE_COUNTER(TRACE_ITERATIONS, iter);
     if (iter > 2)
     {
         DEBUG_PRINTF("%u\n", iter);
     }
 
-    Collision dummy;
-    for (u32 i = 0; i < coll_num; ++i)
     {
-        Obj **obj_pair = game_state->collisions[i].objs;
-
-        if (get_collision(obj_pair, &dummy))
+        PROFILE_SCOPE(PROFILE_NARROW);
+        Collision dummy;
+        for (u32 i = 0; i < coll_num; ++i)
         {
-            DEBUG_PRINTF("Invariant broken - colliding at end of frame\n");
-            game_state->paused = true;
-        }
-    }
-
-
-    for (u32 i = 0; i < coll_num; ++i)
-    {
-        collision = &game_state->collisions[i];
-        Obj **coll_objs = collision->objs;
-        Vec2 *points = collision->points;
-        Vec2 rs[2] = {
-            points[0] - coll_objs[0]->pos,
-            points[1] - coll_objs[1]->pos
-        };
-        f32 mass_recip[2] = {
-            coll_objs[0]->is_static ? 0.0F : 1.0F / coll_objs[0]->mass,
-            coll_objs[1]->is_static ? 0.0F : 1.0F / coll_objs[1]->mass
-        };
-        Vec2 tangential_vels[2] = {
-            Vec3(0, 0, coll_objs[0]->alpha).cross(Vec3(rs[0], 0)).xy(),
-            Vec3(0, 0, coll_objs[1]->alpha).cross(Vec3(rs[1], 0)).xy()
-        };
-        /* Velocities at points of collision */
-        Vec2 point_vels[2] = {
-            coll_objs[0]->vel + tangential_vels[0],
-            coll_objs[1]->vel + tangential_vels[1]
-        };
-        /* Compute impulse */
-        f32 coeff_restitution = 1.0F;
-        Vec2 vel_diff = point_vels[0] - point_vels[1];
-        f32 J_numerator = -(vel_diff.dot(collision->normal)) * (coeff_restitution + 1.0F);
-        Vec3 rs_cross_n_div_I[2] = {
-            coll_objs[0]->is_static ? Vec3() : Vec3(rs[0], 0).cross(Vec3(collision->normal, 0)) / coll_objs[0]->inertia,
-            coll_objs[1]->is_static ? Vec3() : Vec3(rs[1], 0).cross(Vec3(collision->normal, 0)) / coll_objs[1]->inertia
-        };
-        Vec2 cross_rs[2] = {
-            rs_cross_n_div_I[0].cross(Vec3(rs[0], 0)).xy(),
-            rs_cross_n_div_I[1].cross(Vec3(rs[1], 0)).xy()
-        };
-        f32 J_denominator = mass_recip[0] + mass_recip[1] + collision->normal.dot(cross_rs[0] + cross_rs[1]);
-        f32 J_mag = J_numerator / J_denominator;
-        Vec2 J = collision->normal * J_mag;
-        /* Update vels and alphas */
-        if (!coll_objs[0]->is_static)
+            Obj **obj_pair = block->collisions[i].objs;
+
+            if (get_collision(obj_pair, &dummy))
+            {
+                DEBUG_PRINTF("Invariant broken - colliding at end of frame\n");
+                invariant_failures++;
+                game_state->paused = true;
+            }
+        }
+    }
+
+    if (stats_log.file)
+    {
+        PhysicsFrameStats stats = {};
+        stats.frame = frame;
+        for (u32 i = 0; i < num_objs; ++i)
         {
-            coll_objs[0]->vel = coll_objs[0]->vel + J / coll_objs[0]->mass;
-            coll_objs[0]->alpha = coll_objs[0]->alpha + (rs[0].x * J.y - rs[0].y * J.x) / coll_objs[0]->inertia;
+            stats.live_bodies += objs[i].exists != 0;
         }
-        if (!coll_objs[1]->is_static)
+        stats.pairs = pairs_total;
+        stats.collisions = coll_num;
+        stats.iterations = iter;
+        stats.collision_tests = num_collision_tests - collision_tests_start;
+        stats.invariant_failures = invariant_failures;
+        stats_log_write_frame(&stats_log, &stats);
+    }
+
+
+    {
+        PROFILE_SCOPE(PROFILE_SOLVE);
+        for (u32 i = 0; i < coll_num; ++i)
         {
-            coll_objs[1]->vel = coll_objs[1]->vel - J / coll_objs[1]->mass;
-            coll_objs[1]->alpha = coll_objs[1]->alpha - (rs[1].x * J.y - rs[1].y * J.x) / coll_objs[1]->inertia;
+            collision = &block->collisions[i];
+            Obj **coll_objs = collision->objs;
+            Vec2 *points = collision->points;
+            Vec2 rs[2] = {
+                points[0] - coll_objs[0]->pos,
+                points[1] - coll_objs[1]->pos
+            };
+            f32 mass_recip[2] = {
+                coll_objs[0]->is_static ? 0.0F : 1.0F / coll_objs[0]->mass,
+                coll_objs[1]->is_static ? 0.0F : 1.0F / coll_objs[1]->mass
+            };
+            Vec2 tangential_vels[2] = {
+                Vec3(0, 0, coll_objs[0]->alpha).cross(Vec3(rs[0], 0)).xy(),
+                Vec3(0, 0, coll_objs[1]->alpha).cross(Vec3(rs[1], 0)).xy()
+            };
+            /* Velocities at points of collision */
+            Vec2 point_vels[2] = {
+                coll_objs[0]->vel + tangential_vels[0],
+                coll_objs[1]->vel + tangential_vels[1]
+            };
+            /* Compute impulse */
+            f32 coeff_restitution = 1.0F;
+            Vec2 vel_diff = point_vels[0] - point_vels[1];
+            f32 J_numerator = -(vel_diff.dot(collision->normal)) * (coeff_restitution + 1.0F);
+            Vec3 rs_cross_n_div_I[2] = {
+                coll_objs[0]->is_static ? Vec3() : Vec3(rs[0], 0).cross(Vec3(collision->normal, 0)) / coll_objs[0]->inertia,
+                coll_objs[1]->is_static ? Vec3() : Vec3(rs[1], 0).cross(Vec3(collision->normal, 0)) / coll_objs[1]->inertia
+            };
+            Vec2 cross_rs[2] = {
+                rs_cross_n_div_I[0].cross(Vec3(rs[0], 0)).xy(),
+                rs_cross_n_div_I[1].cross(Vec3(rs[1], 0)).xy()
+            };
+            f32 J_denominator = mass_recip[0] + mass_recip[1] + collision->normal.dot(cross_rs[0] + cross_rs[1]);
+            f32 J_mag = J_numerator / J_denominator;
+            Vec2 J = collision->normal * J_mag;
+            /* Update vels and alphas */
+            if (!coll_objs[0]->is_static)
+            {
+                coll_objs[0]->vel = coll_objs[0]->vel + J / coll_objs[0]->mass;
+                coll_objs[0]->alpha = coll_objs[0]->alpha + (rs[0].x * J.y - rs[0].y * J.x) / coll_objs[0]->inertia;
+            }
+            if (!coll_objs[1]->is_static)
+            {
+                coll_objs[1]->vel = coll_objs[1]->vel - J / coll_objs[1]->mass;
+                coll_objs[1]->alpha = coll_objs[1]->alpha - (rs[1].x * J.y - rs[1].y * J.x) / coll_objs[1]->inertia;
+            }
         }
     }
 
-    /* rendering */
-    rendering_clear_screen(render_info, background_color);
-    rendering_set_camera(game_state->camera_pos);
+    block->num_collisions = coll_num;
+    block->mouse_pos = mouse_pos;
+    block->mouse_force_on = mouse_force_on;
+}
+
+static void write_render_snapshot(GameMemoryBlock* block, RenderSnapshot* snapshot, f32 dt)
+{
+    GameState* game_state = block->game_state;
 
-    /* Grid lines */
-    for (int i = 0; i < 20; ++i)
+    snapshot->camera_pos = game_state->camera_pos;
+    snapshot->camera_zoom = camera_zoom(game_state);
+    snapshot->dt = dt;
+    snapshot->static_version = block->static_version;
+    snapshot->mouse_dragging = game_state->mouse_dragging;
+    snapshot->mouse_force_on = block->mouse_force_on;
+    snapshot->mouse_pos = block->mouse_pos;
+    snapshot->mouse_force_origin = game_state->mouse_force_origin;
+
+    /*
+     * Only what the camera can see is kept, so render cost goes with what's on screen.
+     * There's no spatial structure to query (the broad phase is brute force), so it's a linear
+     * pass over the bodies, which is cheap next to drawing them. Static bodies are all kept,
+     * as they're drawn into the renderer's static layer, which doesn't change with the camera
+     */
+    AABB view = camera_view(snapshot->camera_pos, snapshot->camera_zoom);
+
+    u32 num_contacts = 0;
+    for (u32 i = 0; i < block->num_collisions && num_contacts < MAX_RENDER_CONTACTS; ++i)
     {
-        rendering_draw_line(
-            Vec2(-1.0F + i * GRID_SPACING, -1.0F),
-            Vec2(0.0F, 2.0F),
-            1,
-            grid_color);
-        rendering_draw_line(
-            Vec2(-1.0F, -1.0F + i * GRID_SPACING),
-            Vec2(2.0F, 0.0F),
-            1,
-            grid_color);
+        Collision *collision = &block->collisions[i];
+        /* the normals drawn from the points are 0.1 long */
+        AABB bounds = {
+            Vec2(MIN(collision->points[0].x, collision->points[1].x) - 0.1F, MIN(collision->points[0].y, collision->points[1].y) - 0.1F),
+            Vec2(MAX(collision->points[0].x, collision->points[1].x) + 0.1F, MAX(collision->points[0].y, collision->points[1].y) + 0.1F)};
+        if (!bounds.intersects(view))
+            continue;
+        RenderContact *contact = &snapshot->contacts[num_contacts++];
+        contact->points[0] = collision->points[0];
+        contact->points[1] = collision->points[1];
+        contact->normal = collision->normal;
     }
+    snapshot->num_contacts = num_contacts;
 
-    /* objects */
-    for (int i = 0; i < MAX_OBJS; ++i)
+    u32 num_objs = 0;
+    for (u32 i = 0; i < game_state->num_objs; ++i)
     {
         Obj *obj = &game_state->objs[i];
         if (!obj->exists)
             continue;
-        Color obj_color = Color{0.5F,0.8F,0.5F,1.0F};
-        bool obj_wireframe = true;
-        if (obj->is_static) {
-            obj_color = Color{0.6F,0.6F,0.6F,1.0F};
-            obj_wireframe = false;
+        if (!obj->is_static)
+        {
+            /* the AABB can be a step old, so this bounds the body wherever it's turned */
+            f32 bound_radius = obj->shape == Obj::Rect ? 0.5F * sqrtf(obj->width * obj->width + obj->height * obj->height) : obj->radius;
+            AABB bounds = {obj->pos - Vec2(bound_radius, bound_radius), obj->pos + Vec2(bound_radius, bound_radius)};
+            if (!bounds.intersects(view))
+                continue;
         }
-        switch(obj->shape)
+        RenderObj *render_obj = &snapshot->objs[num_objs++];
+        render_obj->pos = obj->pos;
+        render_obj->rot = obj->rot;
+        render_obj->is_rect = obj->shape == Obj::Rect;
+        render_obj->size = render_obj->is_rect ? Vec2(obj->width, obj->height) : Vec2(obj->radius, obj->radius);
+        render_obj->is_static = obj->is_static;
+        if (obj->is_static)
         {
-            case Obj::Circle:
-                rendering_draw_circle(
-                    obj->pos,
-                    obj->rot,
-                    obj->radius,
-                    obj_color,
-                    obj_wireframe);
-                break;
-            case Obj::Rect:
-                rendering_draw_rect(
-                    obj->pos,
-                    obj->rot,
-                    Vec2(obj->width, obj->height),
-                    NULL,
-                    obj_color,
-                    obj_wireframe);
-                break;
-        }
-    }
-
-    /* draw physics stuff */
-    /* actual collisions */
-    for (u32 i = 0; i < coll_num; ++i)
-    {
-        collision = &game_state->collisions[i];
-        Color coll_normal_color = Color{0.0F,0.0F,1.0F,1.0F};
-        for (u32 j = 0; j < 2; ++j)
+            render_obj->color = Color{0.6F,0.6F,0.6F,1.0F};
+            render_obj->wireframe = false;
+        }
+        else
         {
-            Vec2 normal = collision->normal * (j ? -1.0F : 1.0F) * 0.1F;
-            rendering_draw_line(
-                    collision->points[j] + normal,
-                    normal * -1.0F,
-                    2,
-                    coll_normal_color);
-            rendering_draw_circle(
-                    collision->points[j],
-                    0,
-                    0.01F,
-                    coll_normal_color,
-                    false);
+            render_obj->color = Color{0.5F,0.8F,0.5F,1.0F};
+            render_obj->wireframe = true;
         }
     }
+    snapshot->num_objs = num_objs;
+}
 
-    /* aabbs */
-    /*for (int i = 0; i < MAX_OBJS; ++i)
-    {
-        Obj *obj = &game_state->objs[i];
-        if (!obj->exists)
-            continue;
-        obj->aabb.draw(false);
-    }*/
+void game_update(GameMemory* game_memory, GameInputBuffer* input_buffer)
+{
+    GameMemoryBlock* block = (GameMemoryBlock*)(game_memory->memory);
+
+    simulate(block, input_buffer);
 
-    /* p coll pairs (AABBs colliding) */
-    /*for (u32 i = 0; i < p_coll_num; ++i)
     {
-        game_state->p_coll_pairs[i][0]->aabb.draw(true);
-        game_state->p_coll_pairs[i][1]->aabb.draw(true);
-    }*/
+        /* counted as render work, though it's done on the simulation's thread */
+        PROFILE_SCOPE(PROFILE_RENDER);
+        write_render_snapshot(block, &block->snapshots[block->snapshot_buffer.write], input_buffer->dt);
+        triple_buffer_publish(&block->snapshot_buffer);
+    }
+}
 
-    /* mouse force */
-    if (game_state->mouse_dragging)
+static void draw_render_obj(RenderObj* obj)
+{
+    if (obj->is_rect)
+    {
+        rendering_draw_rect(
+            obj->pos,
+            obj->rot,
+            obj->size,
+            NULL,
+            obj->color,
+            obj->wireframe);
+    }
+    else
     {
-        rendering_draw_line(
-                    game_state->mouse_force_origin,
-                    mouse_pos - game_state->mouse_force_origin,
-                    2,
-                    mouse_force_on ? mouse_force_on_color : mouse_force_off_color);
         rendering_draw_circle(
-                    mouse_pos,
-                    0,
-                    0.01F,
-                    mouse_force_on ? mouse_force_on_color : mouse_force_off_color,
-                    false);
+            obj->pos,
+            obj->rot,
+            obj->size.x,
+            obj->color,
+            obj->wireframe);
     }
 }
 
-void game_init_memory(GameMemory* game_memory, GameRenderInfo* render_info)
+void game_render(GameMemory* game_memory, GameRenderInfo* render_info)
 {
-    DEBUG_ASSERT(game_memory->memory_size >= sizeof(GameMemoryBlock));
+    GameMemoryBlock* block = (GameMemoryBlock*)(game_memory->memory);
 
-    rendering_init(game_memory, render_info, GAME_WIDTH_PX, GAME_HEIGHT_PX);
+    /* if there's nothing new, the last snapshot is drawn again */
+    triple_buffer_acquire(&block->snapshot_buffer);
+    RenderSnapshot* snapshot = &block->snapshots[block->snapshot_buffer.read];
 
-    GameMemoryBlock* block = (GameMemoryBlock*)(game_memory->memory);
+    {
+        PROFILE_SCOPE(PROFILE_RENDER);
+        rendering_clear_screen(render_info, background_color);
+        rendering_set_camera(snapshot->camera_pos, snapshot->camera_zoom);
+
+        /* the grid and static bodies don't change, so they're only drawn when the cached layer is out of date */
+        if (rendering_begin_static_layer(snapshot->static_version))
+        {
+            /* Grid lines */
+            for (int i = 0; i < 20; ++i)
+            {
+                rendering_draw_line(
+                    Vec2(-1.0F + i * GRID_SPACING, -1.0F),
+                    Vec2(0.0F, 2.0F),
+                    1,
+                    grid_color);
+                rendering_draw_line(
+                    Vec2(-1.0F, -1.0F + i * GRID_SPACING),
+                    Vec2(2.0F, 0.0F),
+                    1,
+                    grid_color);
+            }
+
+            for (u32 i = 0; i < snapshot->num_objs; ++i)
+            {
+                if (snapshot->objs[i].is_static)
+                {
+                    draw_render_obj(&snapshot->objs[i]);
+                }
+            }
+        }
+        rendering_end_static_layer();
+
+        /* objects */
+        for (u32 i = 0; i < snapshot->num_objs; ++i)
+        {
+            if (!snapshot->objs[i].is_static)
+            {
+                draw_render_obj(&snapshot->objs[i]);
+            }
+        }
+
+        /* draw physics stuff */
+        /* actual collisions */
+        /* all the normals, then all the points, so each is drawn as one batch */
+        Color coll_normal_color = Color{0.0F,0.0F,1.0F,1.0F};
+        for (u32 i = 0; i < snapshot->num_contacts; ++i)
+        {
+            RenderContact *contact = &snapshot->contacts[i];
+            for (u32 j = 0; j < 2; ++j)
+            {
+                Vec2 normal = contact->normal * (j ? -1.0F : 1.0F) * 0.1F;
+                rendering_draw_line(
+                        contact->points[j] + normal,
+                        normal * -1.0F,
+                        2,
+                        coll_normal_color);
+            }
+        }
+        for (u32 i = 0; i < snapshot->num_contacts; ++i)
+        {
+            RenderContact *contact = &snapshot->contacts[i];
+            for (u32 j = 0; j < 2; ++j)
+            {
+                rendering_draw_circle(
+                        contact->points[j],
+                        0,
+                        0.01F,
+                        coll_normal_color,
+                        false);
+            }
+        }
+
+        /* mouse force */
+        if (snapshot->mouse_dragging)
+        {
+            Color mouse_force_color = snapshot->mouse_force_on ? mouse_force_on_color : mouse_force_off_color;
+            rendering_draw_line(
+                        snapshot->mouse_force_origin,
+                        snapshot->mouse_pos - snapshot->mouse_force_origin,
+                        2,
+                        mouse_force_color);
+            rendering_draw_circle(
+                        snapshot->mouse_pos,
+                        0,
+                        0.01F,
+                        mouse_force_color,
+                        false);
+        }
+    }
+
+    profiler_draw_overlay(snapshot->dt);
+    rendering_end_frame();
+}
+
+void game_update_and_render(GameMemory* game_memory, GameInputBuffer* input_buffer, GameRenderInfo* render_info)
+{
+    game_update(game_memory, input_buffer);
+    game_render(game_memory, render_info);
+}
+
+/*
+ * Builds every scene slot's initial state, and copies them to the game states
+ */
+static void init_game_states(GameMemory* game_memory, GameMemoryBlock* block)
+{
     GameState* game_state;
 
     game_state = &block->initial_game_states[0];
 
-    game_state->objs[0] = Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F, 1.0F), 0);
-    game_state->objs[1] = Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F,-1.0F), 0);
-    game_state->objs[2] = Obj::static_rect(0.2F, 2.0F, Vec2( 1.0F, 0.0F), 0);
-    game_state->objs[3] = Obj::static_rect(0.2F, 2.0F, Vec2(-1.0F, 0.0F), 0);
-    game_state->objs[4] = Obj::static_circle(0.2F, Vec2(0.0F,0.0F));
-    game_state->objs[5] = Obj::static_rect(0.2F, 0.4F, Vec2(0.0F, 0.4F), 0);
-    game_state->objs[6] = Obj::static_rect(1.0F, 0.2F, Vec2(-0.5F, 0.0F), 0);
+    game_state->add_obj(Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F, 1.0F), 0));
+    game_state->add_obj(Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F,-1.0F), 0));
+    game_state->add_obj(Obj::static_rect(0.2F, 2.0F, Vec2( 1.0F, 0.0F), 0));
+    game_state->add_obj(Obj::static_rect(0.2F, 2.0F, Vec2(-1.0F, 0.0F), 0));
+    game_state->add_obj(Obj::static_circle(0.2F, Vec2(0.0F,0.0F)));
+    game_state->add_obj(Obj::static_rect(0.2F, 0.4F, Vec2(0.0F, 0.4F), 0));
+    game_state->add_obj(Obj::static_rect(1.0F, 0.2F, Vec2(-0.5F, 0.0F), 0));
 
-    game_state->objs[7] = Obj::dyn_circle(0.2F, Vec2(0.5F,0.0F), 1);
-    game_state->objs[8] = Obj::dyn_rect(0.3F, 0.2F, Vec2(-0.5F,0.5F), M_PI / 4.0F, 1);
+    game_state->add_obj(Obj::dyn_circle(0.2F, Vec2(0.5F,0.0F), 1));
+    game_state->add_obj(Obj::dyn_rect(0.3F, 0.2F, Vec2(-0.5F,0.5F), M_PI / 4.0F, 1));
 
     game_state = &block->initial_game_states[1];
 
-    game_state->objs[0] = Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F, 1.0F), 0);
-    game_state->objs[1] = Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F,-1.0F), 0);
-    game_state->objs[2] = Obj::static_rect(0.2F, 2.0F, Vec2( 1.0F, 0.0F), 0);
-    game_state->objs[3] = Obj::static_rect(0.2F, 2.0F, Vec2(-1.0F, 0.0F), 0);
+    game_state->add_obj(Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F, 1.0F), 0));
+    game_state->add_obj(Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F,-1.0F), 0));
+    game_state->add_obj(Obj::static_rect(0.2F, 2.0F, Vec2( 1.0F, 0.0F), 0));
+    game_state->add_obj(Obj::static_rect(0.2F, 2.0F, Vec2(-1.0F, 0.0F), 0));
 
     for (u32 i = 0; i < 6; ++i)
     {
         for (u32 j = 0; j < 6; ++j)
         {
-            game_state->objs[4 + i * 6 + j] = Obj::dyn_circle(0.14F, Vec2(-0.75F + (f32)i * 0.3F, -0.75F + (f32)j * 0.3F), 1);
+            game_state->add_obj(Obj::dyn_circle(0.14F, Vec2(-0.75F + (f32)i * 0.3F, -0.75F + (f32)j * 0.3F), 1));
         }
     }
 
     game_state = &block->initial_game_states[2];
 
-    game_state->objs[0] = Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F, 1.0F), 0);
-    game_state->objs[1] = Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F,-1.0F), 0);
-    game_state->objs[2] = Obj::static_rect(0.2F, 2.0F, Vec2( 1.0F, 0.0F), 0);
-    game_state->objs[3] = Obj::static_rect(0.2F, 2.0F, Vec2(-1.0F, 0.0F), 0);
+    game_state->add_obj(Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F, 1.0F), 0));
+    game_state->add_obj(Obj::static_rect(2.0F, 0.2F, Vec2( 0.0F,-1.0F), 0));
+    game_state->add_obj(Obj::static_rect(0.2F, 2.0F, Vec2( 1.0F, 0.0F), 0));
+    game_state->add_obj(Obj::static_rect(0.2F, 2.0F, Vec2(-1.0F, 0.0F), 0));
+
+    game_state->add_obj(Obj::dyn_circle(0.25F, Vec2(0.0F,0.0F), 2));
+    game_state->add_obj(Obj::dyn_circle(0.2F, Vec2(0.5F,0.0F), 1));
+    game_state->add_obj(Obj::dyn_rect(0.3F, 0.2F, Vec2(-0.5F,0.5F), M_PI / 4.0F, 1));
+    game_state->add_obj(Obj::dyn_rect(0.3F, 0.2F, Vec2(-0.5F,-0.5F), M_PI / 4.0F, 1));
+    game_state->add_obj(Obj::dyn_rect(0.3F, 0.2F, Vec2(0.5F,-0.5F), M_PI / 4.0F, 1));
+    game_state->add_obj(Obj::dyn_rect(0.3F, 0.2F, Vec2(0.5F,0.5F), M_PI / 4.0F, 1));
+    game_state->add_obj(Obj::dyn_rect(0.3F, 0.2F, Vec2(0.0F,0.5F), M_PI / 3.0F, 1));
+    game_state->add_obj(Obj::dyn_rect(0.3F, 0.2F, Vec2(-0.5F,0.0F), M_PI / 3.0F, 1));
+
+    /* stress scenes */
+    for (int i = 0; i < SCENE_GEN_NUM_PRESETS; ++i)
+    {
+        SceneGenParams params = scene_gen_preset((SceneGenPreset)i, 1);
+        scene_gen_generate(&block->initial_game_states[3 + i], &params);
+    }
 
-    game_state->objs[4] = Obj::dyn_circle(0.25F, Vec2(0.0F,0.0F), 2);
-    game_state->objs[5] = Obj::dyn_circle(0.2F, Vec2(0.5F,0.0F), 1);
-    game_state->objs[6] = Obj::dyn_rect(0.3F, 0.2F, Vec2(-0.5F,0.5F), M_PI / 4.0F, 1);
-    game_state->objs[7] = Obj::dyn_rect(0.3F, 0.2F, Vec2(-0.5F,-0.5F), M_PI / 4.0F, 1);
-    game_state->objs[8] = Obj::dyn_rect(0.3F, 0.2F, Vec2(0.5F,-0.5F), M_PI / 4.0F, 1);
-    game_state->objs[9] = Obj::dyn_rect(0.3F, 0.2F, Vec2(0.5F,0.5F), M_PI / 4.0F, 1);
-    game_state->objs[10] = Obj::dyn_rect(0.3F, 0.2F, Vec2(0.0F,0.5F), M_PI / 3.0F, 1);
-    game_state->objs[11] = Obj::dyn_rect(0.3F, 0.2F, Vec2(-0.5F,0.0F), M_PI / 3.0F, 1);
+    for (int i = 0; i < GAME_NUM_SCENE_SLOTS; ++i)
+    {
+        const char *scene_path = game_memory->scene_paths[i];
+        if (!scene_path)
+            continue;
+        if (!load_scene(&block->initial_game_states[i], scene_path))
+        {
+            FATAL_PRINTF("Couldn't load scene \"%s\" into slot %d\n", scene_path, i);
+        }
+    }
 
-    for (int i = 0; i < 10; ++i)
+    for (int i = 0; i < GAME_NUM_SCENE_SLOTS; ++i)
     {
-        memcpy(&block->game_states[i], &block->initial_game_states[i], sizeof(GameState));
+        copy_game_state(&block->game_states[i], &block->initial_game_states[i]);
     }
 
     block->game_state = &block->game_states[0];
 }
+
+/*
+ * Whether the memory is a block left by a run that shut down cleanly, at this address with
+ * this build's layout, so the game can carry on from it
+ */
+static bool can_resume(GameMemory* game_memory, GameMemoryBlock* block)
+{
+    if (!game_memory->memory_restored)
+    {
+        return false;
+    }
+    if (block->checkpoint_magic != GAME_CHECKPOINT_MAGIC || block->checkpoint_size != sizeof(GameMemoryBlock))
+    {
+        DEBUG_PRINTF("Checkpoint is from another build, starting over\n");
+        return false;
+    }
+    if (block->checkpoint_address != block)
+    {
+        DEBUG_PRINTF("Checkpoint was mapped at %p rather than %p, starting over\n", (void*)block, (void*)block->checkpoint_address);
+        return false;
+    }
+    if (!block->shut_down_cleanly)
+    {
+        DEBUG_PRINTF("Checkpoint was left mid-frame, starting over\n");
+        return false;
+    }
+    return true;
+}
+
+void game_init_memory(GameMemory* game_memory, GameRenderInfo* render_info)
+{
+    DEBUG_ASSERT(game_memory->memory_size >= sizeof(GameMemoryBlock));
+
+    rendering_init(game_memory, render_info, GAME_WIDTH_PX, GAME_HEIGHT_PX);
+
+    GameMemoryBlock* block = (GameMemoryBlock*)(game_memory->memory);
+    if (can_resume(game_memory, block))
+    {
+        // scene files aren't loaded again, the slots keep what they had
+        DEBUG_PRINTF("Resuming from checkpoint, in scene %u\n", block->curr_state_i);
+    }
+    else
+    {
+        if (game_memory->memory_restored)
+        {
+            // the rest of the game expects to start from zeros
+            memset((void*)block, 0, sizeof(GameMemoryBlock));
+        }
+        init_game_states(game_memory, block);
+        block->checkpoint_magic = GAME_CHECKPOINT_MAGIC;
+        block->checkpoint_size = sizeof(GameMemoryBlock);
+        block->checkpoint_address = block;
+    }
+    // set again by game_shutdown, once nothing else will change
+    block->shut_down_cleanly = false;
+    triple_buffer_init(&block->snapshot_buffer);
+    // drawn until the first update publishes one, so it needs a real camera
+    write_render_snapshot(block, &block->snapshots[block->snapshot_buffer.read], 0.0F);
+
+    trace_set_thread_name("main");
+    if (game_memory->trace_path && !trace_begin(game_memory->trace_path))
+    {
+        FATAL_PRINTF("Couldn't trace to \"%s\"\n", game_memory->trace_path);
+    }
+    if (game_memory->stats_path && !stats_log_begin(&stats_log, game_memory->stats_path))
+    {
+        FATAL_PRINTF("Couldn't log physics stats to \"%s\"\n", game_memory->stats_path);
+    }
+}
+
+void game_shutdown(GameMemory* game_memory)
+{
+    trace_end();
+    stats_log_end(&stats_log);
+    GameMemoryBlock* block = (GameMemoryBlock*)(game_memory->memory);
+    block->shut_down_cleanly = true;
+}
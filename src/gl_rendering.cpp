@@ -5,6 +5,22 @@
 #define VERT_EXT ".vert"
 #define FRAG_EXT ".frag"
 
+// Uniforms set per draw, looked up once when the shader is loaded
+enum ShaderUniform
+{
+    UNIFORM_SPRITE_TEXTURE,
+    UNIFORM_OUTLINE,
+    NUM_SHADER_UNIFORMS,
+};
+static const char* shader_uniform_names[NUM_SHADER_UNIFORMS] = {
+    "sprite_texture",
+    "outline",
+};
+
+// Uniform block with the projection and view matrices, shared by all shaders
+#define CAMERA_BLOCK_NAME "Camera"
+static const GLuint CAMERA_BLOCK_BINDING = 0;
+
 struct Shader
 {
     static const int MAX_NAME = 64;
@@ -12,76 +28,324 @@ struct Shader
     bool initialized;
     char name[MAX_NAME];   // determines which shader to load: shaders/<name>.vert and shaders/<name>.frag
     GLuint id;
+    GLint uniforms[NUM_SHADER_UNIFORMS];  // -1 for uniforms the shader doesn't have
+};
+
+#define ATLAS_PAGE_SIZE 1024     // the smallest GL_MAX_TEXTURE_SIZE GL 3.3 allows
+#define MAX_ATLAS_PAGES 16
+#define MAX_ATLAS_FREE_RECTS 64
+/*
+ * Texels around each packed texture, holding copies of its edge texels, so sampling right at
+ * its edge gets what GL_CLAMP_TO_EDGE would rather than a neighbour. upload_texture fills one
+ */
+#define ATLAS_PADDING 1
+
+struct AtlasRect
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+/*
+ * GL texture that textures are packed into on shelves: rows filled left to right, each as tall
+ * as the tallest texture in it. Textures too big to share get a dedicated page of their own
+ */
+struct AtlasPage
+{
+    GLuint id;                  // 0 while the page is unused
+    uint32_t width;
+    uint32_t height;
+    bool dedicated;
+    uint32_t num_textures;
+    uint32_t shelf_x;           // free space on the current shelf starts here
+    uint32_t shelf_y;
+    uint32_t shelf_height;
+    uint32_t num_free_rects;    // space from destroyed textures, reused before the shelves
+    AtlasRect free_rects[MAX_ATLAS_FREE_RECTS];
 };
 
 // Use Texture* internally, and RenderTexture externally
 struct Texture
 {
     bool initialized = false;
-    GLuint id;
+    AtlasPage* page;
+    AtlasRect rect;         // space taken in the page, including padding
+    uint32_t x;             // the image's bottom left texel in the page
+    uint32_t y;
     uint32_t width;
     uint32_t height;
+    Texture* next_free;
 };
 
-struct Rect
+/*
+ * Static unit mesh drawn once per instance, scaled, rotated and moved by the per instance
+ * attributes in shaders/instanced.vert
+ */
+struct InstancedMesh
 {
     GLuint VAO;
     GLuint vertices_VBO;
-    GLuint texture_coords_VBO;
+    GLuint instances_VBO;
     GLuint EBO;
+    GLsizei num_indices;
+    GLuint static_layer_VAO;    // same mesh, with instances read from the static layer
 };
 
-#define NUM_CIRCLE_POINTS 64
+// Per instance vertex attributes, must match shaders/instanced.vert and shaders/circle.vert
+struct ShapeInstance
+{
+    GLfloat pos_rot[3];
+    GLfloat size[2];
+    GLfloat color[4];
+};
 
-struct Circle
+#define MAX_SHAPE_INSTANCES 4096
+
+// Shapes queued during the frame, drawn together by flush_shapes
+struct ShapeBatch
 {
-    GLuint VAO;
-    GLuint vertices_VBO;
-    GLuint EBO;
+    InstancedMesh* mesh;
+    Shader* shader;
+    bool wireframe;         // drawn with glPolygonMode(GL_LINE)
+    bool outline;           // shader draws the outline itself, see shaders/circle.frag
+    uint32_t count;
+    ShapeInstance instances[MAX_SHAPE_INSTANCES];
+};
+
+// Vertex of a batched line, must match shaders/line.vert
+struct LineVertex
+{
+    GLfloat pos[2];
+    GLfloat color[4];
 };
 
-struct Line
+#define MAX_LINE_VERTICES 16384
+
+/*
+ * Lines queued during the frame, drawn together by flush_lines.
+ * 1px lines are drawn as GL_LINES, wider ones as two triangles each, since core profile
+ * implementations only have to support glLineWidth(1)
+ */
+struct LineBatch
 {
     GLuint VAO;
-    GLuint vertices_VBO;
-    GLuint EBO;
+    GLuint vertices_VBO;    // thin vertices, then wide vertices from MAX_LINE_VERTICES on
+    uint32_t num_thin;
+    uint32_t num_wide;
+    LineVertex thin[MAX_LINE_VERTICES];     // 2 per line
+    LineVertex wide[MAX_LINE_VERTICES];     // 6 per line
 };
 
-static const uint32_t RECT_TEX_COORDS_ARRAY_SIZE = 8;
-static const uint32_t RECT_TEX_COORDS_SIZE = RECT_TEX_COORDS_ARRAY_SIZE * sizeof(GLfloat);
-static const GLfloat RECT_DEFAULT_TEX_COORDS[RECT_TEX_COORDS_ARRAY_SIZE] =
-    {1, 1,
-    0, 1,
-    0, 0,
-    1, 0};
+// Per instance vertex attributes, must match shaders/sprite.vert
+struct SpriteInstance
+{
+    GLfloat pos_rot[3];
+    GLfloat size[2];
+    GLfloat color[4];
+    GLfloat tex_rect[4];    // page tex coords at the bottom left corner, then the top right
+};
+
+#define MAX_SPRITE_INSTANCES 4096
+// Sprites are drawn in groups by page, filled then wireframe
+#define NUM_SPRITE_GROUPS (2 * MAX_ATLAS_PAGES)
+
+/*
+ * Textured rects and sprites queued during the frame, drawn by flush_sprites with one draw per
+ * atlas page. Sprites on different pages don't keep the order they were queued in
+ */
+struct SpriteBatch
+{
+    GLuint VAO;
+    GLuint instances_VBO;
+    GLuint static_layer_VAO;    // same mesh, with instances read from the static layer
+    uint32_t count;
+    uint8_t groups[MAX_SPRITE_INSTANCES];
+    SpriteInstance instances[MAX_SPRITE_INSTANCES];
+    SpriteInstance sorted[MAX_SPRITE_INSTANCES];    // by group, built by flush_sprites
+};
 
 // Used to draw all primitive
-static Rect global_rect;
-static Line global_line;
-static Circle global_circle;
+static LineBatch line_batch;
+static SpriteBatch sprite_batch;
+static InstancedMesh instanced_rect;    // also used for circles, see shaders/circle.vert
 
-// The shader used to draw rects
+// The shader used to draw textured rects and sprites
 static Shader sprite_shader;
+// The shader used to draw untextured rects
+static Shader instanced_shader;
+// The shader used to draw circles, on quads
+static Shader circle_shader;
+// The shader used to draw lines
+static Shader line_shader;
+
+/*
+ * Drawn in this order, so filled shapes are under wireframe ones. Sorted so the polygon mode
+ * changes once and the shader twice per flush
+ */
+enum ShapeBatchType
+{
+    SHAPE_BATCH_RECT,
+    SHAPE_BATCH_CIRCLE,
+    SHAPE_BATCH_CIRCLE_WIREFRAME,
+    SHAPE_BATCH_RECT_WIREFRAME,
+    NUM_SHAPE_BATCHES,
+};
+static ShapeBatch shape_batches[NUM_SHAPE_BATCHES];
 
-// idk
-static const int MAX_TEXTURES = 256;
+static const int MAX_TEXTURES = 4096;
 static Texture textures[MAX_TEXTURES];
-static Texture* empty_texture;
+static Texture* free_textures;      // linked through next_free
+static AtlasPage atlas_pages[MAX_ATLAS_PAGES];
+
+
+static RenderViewport gl_viewport = {0, 0, GAME_WIDTH_PX, GAME_HEIGHT_PX};
 
+#define MAX_STATIC_LAYER_INSTANCES 65536
+#define MAX_STATIC_LAYER_LINE_VERTICES 16384
+#define MAX_STATIC_LAYER_SPRITES 16384
+#define MAX_STATIC_LAYER_RUNS 256
 
-static const float GAME_ASPECT = (float)GAME_WIDTH_PX/(float)GAME_HEIGHT_PX;
+// One batch flushed while recording the static layer, drawn again with a single draw call
+struct StaticLayerRun
+{
+    ShapeBatch* batch;      // NULL for lines and sprites
+    GLenum line_mode;       // GL_LINES or GL_TRIANGLES, for lines
+    bool sprites;
+    uint32_t sprite_group;  // for sprites
+    uint32_t first;         // first instance or vertex in the layer's buffer
+    uint32_t count;
+};
+
+/*
+ * Everything drawn between rendering_begin/end_static_layer, kept in static buffers.
+ * While recording, batches are copied here when they're flushed instead of being drawn, and
+ * the runs are drawn again in the same order each frame
+ */
+struct StaticLayer
+{
+    bool valid;             // holds the layer for version, viewport_width and zoom
+    bool recording;         // between a begin that returned true and its end
+    bool overflowed;        // didn't fit, so it's drawn directly every frame until version changes
+    u32 version;
+    int viewport_width;     // wide lines are sized in pixels
+    f32 zoom;
+
+    GLuint instances_VBO;
+    uint32_t num_instances;
+    GLuint lines_VAO;
+    GLuint lines_VBO;
+    uint32_t num_line_vertices;
+    GLuint sprites_VBO;
+    uint32_t num_sprites;
+    uint32_t num_runs;
+    StaticLayerRun runs[MAX_STATIC_LAYER_RUNS];
+};
+static StaticLayer static_layer;
 
-static GLint gl_viewport_x = 0;
-static GLint gl_viewport_y = 0;
-static GLsizei gl_viewport_width = GAME_WIDTH_PX;
-static GLsizei gl_viewport_height = GAME_HEIGHT_PX;
+#define NUM_CAPTURE_BUFFERS 3
+
+// A frame being read back for rendering_capture_frame
+struct CaptureBuffer
+{
+    GLuint PBO;
+    GLsizeiptr size;        // allocated
+    GLsync fence;           // signalled when the read into PBO is done
+    int width;
+    int height;
+};
+
+/*
+ * Frames are read into a ring of pixel buffers, and only mapped once their fence says the
+ * copy is done, so capturing never waits on the GPU
+ */
+struct Capture
+{
+    CaptureBuffer buffers[NUM_CAPTURE_BUFFERS];
+    uint32_t next;          // next buffer to read into
+    uint32_t num_pending;   // being read, the oldest is num_pending before next
+};
+static Capture capture;
 
 // Camera view matrix for world -> camera coords
 static Mat4 view;
+static f32 camera_zoom = 1.0F;
 
 // Camera projection matrix for pixel -> screen space transformation
 static Mat4 projection;
 
+// Uniform buffer holding projection then view, laid out as the Camera block in the shaders
+static GLuint camera_UBO;
+
+/*
+ * GL state last set through the wrappers below, which skip calls that wouldn't change it.
+ * All binds of these in this file have to go through the wrappers to keep it in sync.
+ * Starts at GL's defaults
+ */
+struct GLState
+{
+    GLuint program;
+    GLuint VAO;
+    GLuint texture;         // bound to GL_TEXTURE_2D on texture unit 0, the only unit used
+    GLenum polygon_mode;
+    bool blend;
+};
+static GLState gl_state = {0, 0, 0, GL_FILL, false};
+
+static void use_program(GLuint id)
+{
+    if (gl_state.program != id)
+    {
+        glUseProgram(id);
+        gl_state.program = id;
+    }
+}
+
+static void bind_vertex_array(GLuint VAO)
+{
+    if (gl_state.VAO != VAO)
+    {
+        glBindVertexArray(VAO);
+        gl_state.VAO = VAO;
+    }
+}
+
+static void bind_texture(GLuint id)
+{
+    if (gl_state.texture != id)
+    {
+        glBindTexture(GL_TEXTURE_2D, id);
+        gl_state.texture = id;
+    }
+}
+
+static void set_polygon_mode(bool wireframe)
+{
+    GLenum mode = wireframe ? GL_LINE : GL_FILL;
+    if (gl_state.polygon_mode != mode)
+    {
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+        gl_state.polygon_mode = mode;
+    }
+}
+
+static void set_blend(bool blend)
+{
+    if (gl_state.blend != blend)
+    {
+        if (blend)
+        {
+            glEnable(GL_BLEND);
+        }
+        else
+        {
+            glDisable(GL_BLEND);
+        }
+        gl_state.blend = blend;
+    }
+}
+
 // buffer for errors from opengl
 static const int INFO_LOG_SIZE = 512;
 static char info_log[INFO_LOG_SIZE];
@@ -89,7 +353,7 @@ static char info_log[INFO_LOG_SIZE];
 /*
  * Initialized a shader struct
  */
-static void load_shader(GameMemory* game_memory, Shader* shader, char* name)
+static void load_shader(GameMemory* game_memory, Shader* shader, const char* name)
 {
     int success;
 
@@ -167,40 +431,195 @@ static void load_shader(GameMemory* game_memory, Shader* shader, char* name)
     glDeleteShader(frag_id);
     DEBUG_platform_free_file_memory(frag_source);
 
+    // Look up uniforms now rather than by name on every draw
+    for (int i = 0; i < NUM_SHADER_UNIFORMS; ++i)
+    {
+        shader->uniforms[i] = glGetUniformLocation(shader->id, shader_uniform_names[i]);
+    }
+    GLuint camera_block = glGetUniformBlockIndex(shader->id, CAMERA_BLOCK_NAME);
+    if (camera_block != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(shader->id, camera_block, CAMERA_BLOCK_BINDING);
+    }
+    // samplers always read from texture unit 0
+    if (shader->uniforms[UNIFORM_SPRITE_TEXTURE] != -1)
+    {
+        use_program(shader->id);
+        glUniform1i(shader->uniforms[UNIFORM_SPRITE_TEXTURE], 0);
+    }
+
     shader->initialized = true;
 }
 
-RenderTexture rendering_create_texture(void* image_data, uint32_t width, uint32_t height)
+/*
+ * Makes a page's GL texture, its texels are undefined until textures are uploaded to it
+ */
+static void init_atlas_page(AtlasPage* page, uint32_t width, uint32_t height, bool dedicated)
+{
+    memset(page, 0, sizeof(AtlasPage));
+    page->width = width;
+    page->height = height;
+    page->dedicated = dedicated;
+
+    glGenTextures(1, &page->id);
+    bind_texture(page->id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // no mipmaps, so the texture is complete with just level 0
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+}
+
+/*
+ * Finds space for a width x height rect on a page: first in the space given back by destroyed
+ * textures, then on the current shelf, then on a new shelf. Returns false if the page is full
+ */
+static bool pack_atlas_rect(AtlasPage* page, uint32_t width, uint32_t height, AtlasRect* rect)
 {
-    Texture* ret = NULL;
-    for (int i = 0; i < MAX_TEXTURES; ++i)
+    for (uint32_t i = 0; i < page->num_free_rects; ++i)
     {
-        if (!textures[i].initialized)
+        AtlasRect* free_rect = &page->free_rects[i];
+        if (free_rect->width >= width && free_rect->height >= height)
         {
-            ret = &(textures[i]);
-            break;
+            // the whole free rect is used, so it goes back whole when this is destroyed
+            *rect = *free_rect;
+            *free_rect = page->free_rects[--page->num_free_rects];
+            return true;
         }
     }
-    if (!ret) {
-        DEBUG_PRINTF("ERROR: Failed to allocate texture\n");
-        return ret;
+    uint32_t x = page->shelf_x;
+    uint32_t y = page->shelf_y;
+    uint32_t shelf_height = page->shelf_height;
+    if (x + width > page->width)
+    {
+        // new shelf
+        x = 0;
+        y += shelf_height;
+        shelf_height = 0;
+    }
+    if (y + height > page->height)
+    {
+        return false;
     }
+    rect->x = x;
+    rect->y = y;
+    rect->width = width;
+    rect->height = height;
+    page->shelf_x = x + width;
+    page->shelf_y = y;
+    // the last shelf can grow, nothing is above it
+    page->shelf_height = MAX(shelf_height, height);
+    return true;
+}
 
-    // Create and load texture
-    glGenTextures(1, &ret->id);
-    glBindTexture(GL_TEXTURE_2D, ret->id);
+/*
+ * Picks a page and space on it for a texture of width x height, opening a page if need be
+ */
+static bool allocate_atlas_space(Texture* tex, uint32_t width, uint32_t height)
+{
+    uint32_t padded_width = width + 2 * ATLAS_PADDING;
+    uint32_t padded_height = height + 2 * ATLAS_PADDING;
+    bool dedicated = padded_width > ATLAS_PAGE_SIZE / 2 || padded_height > ATLAS_PAGE_SIZE / 2;
+    AtlasPage* unused_page = NULL;
+    for (int i = 0; i < MAX_ATLAS_PAGES; ++i)
+    {
+        AtlasPage* page = &atlas_pages[i];
+        if (!page->id)
+        {
+            unused_page = unused_page ? unused_page : page;
+            continue;
+        }
+        if (!dedicated && !page->dedicated && pack_atlas_rect(page, padded_width, padded_height, &tex->rect))
+        {
+            tex->page = page;
+            tex->x = tex->rect.x + ATLAS_PADDING;
+            tex->y = tex->rect.y + ATLAS_PADDING;
+            return true;
+        }
+    }
+    if (!unused_page)
+    {
+        return false;
+    }
+    tex->page = unused_page;
+    if (dedicated)
+    {
+        init_atlas_page(unused_page, width, height, true);
+        tex->rect = AtlasRect{0, 0, width, height};
+        tex->x = 0;
+        tex->y = 0;
+        return true;
+    }
+    init_atlas_page(unused_page, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, false);
+    pack_atlas_rect(unused_page, padded_width, padded_height, &tex->rect);
+    tex->x = tex->rect.x + ATLAS_PADDING;
+    tex->y = tex->rect.y + ATLAS_PADDING;
+    return true;
+}
 
-    // init textures
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+static void flush_sprites();
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
-    glGenerateMipmap(GL_TEXTURE_2D);    // we need to do this, even though we aren't using mipmaps
+/*
+ * Copies width x height texels of the image from (src_x, src_y) to (x, y) in the bound texture.
+ * GL_UNPACK_ROW_LENGTH has to be set to the image's width
+ */
+static void upload_texels(void* image_data, int src_x, int src_y, int x, int y, int width, int height)
+{
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, src_x);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, src_y);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
+}
+
+static void upload_texture(Texture* tex, void* image_data)
+{
+    int x = tex->x;
+    int y = tex->y;
+    int w = tex->width;
+    int h = tex->height;
+
+    // sprites already queued have to see the old pixels
+    flush_sprites();
+    bind_texture(tex->page->id);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, w);
+    upload_texels(image_data, 0, 0, x, y, w, h);
+    if (!tex->page->dedicated)
+    {
+        // edges, then corners
+        upload_texels(image_data, 0, 0, x - 1, y, 1, h);
+        upload_texels(image_data, w - 1, 0, x + w, y, 1, h);
+        upload_texels(image_data, 0, 0, x, y - 1, w, 1);
+        upload_texels(image_data, 0, h - 1, x, y + h, w, 1);
+        upload_texels(image_data, 0, 0, x - 1, y - 1, 1, 1);
+        upload_texels(image_data, w - 1, 0, x + w, y - 1, 1, 1);
+        upload_texels(image_data, 0, h - 1, x - 1, y + h, 1, 1);
+        upload_texels(image_data, w - 1, h - 1, x + w, y + h, 1, 1);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+}
+
+RenderTexture rendering_create_texture(void* image_data, uint32_t width, uint32_t height)
+{
+    Texture* ret = free_textures;
+    if (!ret)
+    {
+        DEBUG_PRINTF("ERROR: Failed to allocate texture\n");
+        return ret;
+    }
+    if (!allocate_atlas_space(ret, width, height))
+    {
+        DEBUG_PRINTF("ERROR: No atlas space for a %ux%u texture\n", width, height);
+        return NULL;
+    }
+    free_textures = ret->next_free;
 
     ret->width = width;
     ret->height = height;
+    ret->page->num_textures++;
+    upload_texture(ret, image_data);
 
     ret->initialized = true;
 
@@ -210,129 +629,246 @@ RenderTexture rendering_create_texture(void* image_data, uint32_t width, uint32_
 void rendering_replace_texture(RenderTexture _tex, void* image_data)
 {
     Texture *tex = (Texture *)_tex;
+    DEBUG_ASSERT(tex->initialized);
+    upload_texture(tex, image_data);
+}
 
-    glBindTexture(GL_TEXTURE_2D, tex->id);
+void rendering_destroy_texture(RenderTexture _tex)
+{
+    Texture* tex = (Texture*)_tex;
+    DEBUG_ASSERT(tex->initialized);
+    AtlasPage* page = tex->page;
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex->width, tex->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
-    glGenerateMipmap(GL_TEXTURE_2D);    // we need to do this, even though we aren't using mipmaps
+    page->num_textures--;
+    if (page->dedicated)
+    {
+        // queued sprites may still use it
+        flush_sprites();
+        glDeleteTextures(1, &page->id);
+        if (gl_state.texture == page->id)
+        {
+            gl_state.texture = 0;
+        }
+        page->id = 0;
+    }
+    else if (!page->num_textures)
+    {
+        // empty, so start packing from scratch
+        page->shelf_x = 0;
+        page->shelf_y = 0;
+        page->shelf_height = 0;
+        page->num_free_rects = 0;
+    }
+    else if (page->num_free_rects < MAX_ATLAS_FREE_RECTS)
+    {
+        page->free_rects[page->num_free_rects++] = tex->rect;
+    }
+    // otherwise the space is lost until the page is empty
+
+    tex->initialized = false;
+    tex->next_free = free_textures;
+    free_textures = tex;
 }
 
-static void init_rect(Rect* rect)
+/*
+ * Points the bound VAO's per instance attributes at the bound GL_ARRAY_BUFFER, starting at first_instance
+ */
+static void set_instance_attributes(uint32_t first_instance)
 {
-    // Create and bind VAO
-    glGenVertexArrays(1, &rect->VAO);
-    glBindVertexArray(rect->VAO);
-    {
-        // Vertex position array
-        glGenBuffers(1, &rect->vertices_VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, rect->vertices_VBO);
-        GLfloat vertices[12] = {0};
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
-
-        // vertex data interpretation - applied to currently bound VBO
-        // 1st arg is the vertex attribute location we want to configure (0), we specify this in the shader with layout(location = 0)
-        // 2nd arg is the number of components per vertex
-        // 3rd arg is the type of each element
-        // 4th arg is whether data should be normalized (mapped into range [-1, 1] or [0, 1] for unsigned)
-        // 5th arg is the stride
-        // 6th arg is a (byte) offset of where to start in the array
+    static const int POS_ROT_LOCATION = 2;
+    static const int SIZE_LOCATION = 3;
+    static const int COLOR_LOCATION = 4;
+    size_t offset = first_instance * sizeof(ShapeInstance);
+    glVertexAttribPointer(POS_ROT_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), (void*)(offset + offsetof(ShapeInstance, pos_rot)));
+    glVertexAttribPointer(SIZE_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), (void*)(offset + offsetof(ShapeInstance, size)));
+    glVertexAttribPointer(COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), (void*)(offset + offsetof(ShapeInstance, color)));
+    glEnableVertexAttribArray(POS_ROT_LOCATION);
+    glEnableVertexAttribArray(SIZE_LOCATION);
+    glEnableVertexAttribArray(COLOR_LOCATION);
+    // advance once per instance instead of per vertex
+    glVertexAttribDivisor(POS_ROT_LOCATION, 1);
+    glVertexAttribDivisor(SIZE_LOCATION, 1);
+    glVertexAttribDivisor(COLOR_LOCATION, 1);
+}
+
+/*
+ * Points the bound VAO's per instance sprite attributes at the bound GL_ARRAY_BUFFER, starting at first_instance
+ */
+static void set_sprite_attributes(uint32_t first_instance)
+{
+    static const int POS_ROT_LOCATION = 2;
+    static const int SIZE_LOCATION = 3;
+    static const int COLOR_LOCATION = 4;
+    static const int TEX_RECT_LOCATION = 5;
+    size_t offset = first_instance * sizeof(SpriteInstance);
+    glVertexAttribPointer(POS_ROT_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, pos_rot)));
+    glVertexAttribPointer(SIZE_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, size)));
+    glVertexAttribPointer(COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, color)));
+    glVertexAttribPointer(TEX_RECT_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, tex_rect)));
+    glEnableVertexAttribArray(POS_ROT_LOCATION);
+    glEnableVertexAttribArray(SIZE_LOCATION);
+    glEnableVertexAttribArray(COLOR_LOCATION);
+    glEnableVertexAttribArray(TEX_RECT_LOCATION);
+    glVertexAttribDivisor(POS_ROT_LOCATION, 1);
+    glVertexAttribDivisor(SIZE_LOCATION, 1);
+    glVertexAttribDivisor(COLOR_LOCATION, 1);
+    glVertexAttribDivisor(TEX_RECT_LOCATION, 1);
+}
 
+/*
+ * Builds the static mesh and sets up the per instance attributes, which are read from
+ * instances_VBO once per instance rather than once per vertex
+ */
+static void init_instanced_mesh(InstancedMesh* mesh, GLfloat* vertices, GLsizeiptr vertices_size, GLuint* indices, GLsizei num_indices)
+{
+    glGenVertexArrays(1, &mesh->VAO);
+    bind_vertex_array(mesh->VAO);
+    {
+        glGenBuffers(1, &mesh->vertices_VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vertices_VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices_size, vertices, GL_STATIC_DRAW);
         static const int VERT_POS_LOCATION = 0;
         glVertexAttribPointer(VERT_POS_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(VERT_POS_LOCATION); // enable it, giving the vertex attribute location
-
-        // Texture coords
-        // TODO make tex coords efficient - only change when needed or something, or store all coordinates up front, and index them in the shader based on curr frame
-        glGenBuffers(1, &rect->texture_coords_VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, rect->texture_coords_VBO);
-        static const int TEX_COORDS_LOCATION = 1;
-        glVertexAttribPointer(TEX_COORDS_LOCATION, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(TEX_COORDS_LOCATION);
-        //default to be overwritten at runtime if needed
-        glBufferData(GL_ARRAY_BUFFER, RECT_TEX_COORDS_SIZE, RECT_DEFAULT_TEX_COORDS, GL_STREAM_DRAW);
+        glEnableVertexAttribArray(VERT_POS_LOCATION);
+
+        // Instance array, filled in by flush_shapes
+        glGenBuffers(1, &mesh->instances_VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->instances_VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(ShapeInstance) * MAX_SHAPE_INSTANCES, NULL, GL_STREAM_DRAW);
+        set_instance_attributes(0);
 
         // Index array
-        glGenBuffers(1, &rect->EBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rect->EBO);
-        const GLuint indices[2 * 3] = {0, 1, 2,       // 2 triangles in CCW order; note these correspond to vertices[] above
-                                       0, 2, 3};
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glGenBuffers(1, &mesh->EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, num_indices * sizeof(GLuint), indices, GL_STATIC_DRAW);
+        mesh->num_indices = num_indices;
     }
     // unbind the VAO
-    DEBUG_ASSERT(rect->VAO != 0);
-    glBindVertexArray(0);
+    DEBUG_ASSERT(mesh->VAO != 0);
+    bind_vertex_array(0);
+
+    // The same again, reading instances from the static layer
+    glGenVertexArrays(1, &mesh->static_layer_VAO);
+    bind_vertex_array(mesh->static_layer_VAO);
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vertices_VBO);
+        static const int VERT_POS_LOCATION = 0;
+        glVertexAttribPointer(VERT_POS_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(VERT_POS_LOCATION);
+
+        glBindBuffer(GL_ARRAY_BUFFER, static_layer.instances_VBO);
+        set_instance_attributes(0);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
+    }
+    bind_vertex_array(0);
 }
 
-static void init_circle(Circle* circle)
+/* Square with sides of 1, centred on the origin */
+static void init_unit_rect(InstancedMesh* mesh)
 {
-    // Create and bind VAO
-    glGenVertexArrays(1, &circle->VAO);
-    glBindVertexArray(circle->VAO);
-    {
-        // Vertex position array
-        glGenBuffers(1, &circle->vertices_VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, circle->vertices_VBO);
-        GLfloat vertices[(NUM_CIRCLE_POINTS + 1) * 3] = {0};
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
-
-        // vertex data interpretation - applied to currently bound VBO
-        // 1st arg is the vertex attribute location we want to configure (0), we specify this in the shader with layout(location = 0)
-        // 2nd arg is the number of components per vertex
-        // 3rd arg is the type of each element
-        // 4th arg is whether data should be normalized (mapped into range [-1, 1] or [0, 1] for unsigned)
-        // 5th arg is the stride
-        // 6th arg is a (byte) offset of where to start in the array
+    GLfloat vertices[12] = {
+        // top right
+        0.5F,    0.5F,   0.0F,
+        // top left
+        -0.5F,   0.5F,   0.0F,
+        // bottom left
+        -0.5F,  -0.5F,   0.0F,
+        // bottom right
+        0.5F,   -0.5F,   0.0F,
+    };
+    GLuint indices[2 * 3] = {0, 1, 2,       // 2 triangles in CCW order
+                             0, 2, 3};
+    init_instanced_mesh(mesh, vertices, sizeof(vertices), indices, 2 * 3);
+}
 
+/*
+ * Sets up the sprite batch's VAOs, which draw instances of mesh with the sprite attributes
+ */
+static void init_sprite_batch(SpriteBatch* batch, InstancedMesh* mesh)
+{
+    glGenVertexArrays(1, &batch->VAO);
+    bind_vertex_array(batch->VAO);
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vertices_VBO);
         static const int VERT_POS_LOCATION = 0;
         glVertexAttribPointer(VERT_POS_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(VERT_POS_LOCATION); // enable it, giving the vertex attribute location
+        glEnableVertexAttribArray(VERT_POS_LOCATION);
 
-        // Index array
-        glGenBuffers(1, &circle->EBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, circle->EBO);
-        // sequence of triangles in ccw order
-        GLuint indices[NUM_CIRCLE_POINTS * 3] = {};
-        for (int i = 0; i < NUM_CIRCLE_POINTS; ++i)
-        {
-            int start_i = i * 3;
-            // center
-            indices[start_i + 0] = NUM_CIRCLE_POINTS;
-            // current point
-            indices[start_i + 1] = i;
-            // next point, wrapping back to first
-            indices[start_i + 2] = (i + 1) % NUM_CIRCLE_POINTS;
-        }
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        // Instance array, filled in by flush_sprites
+        glGenBuffers(1, &batch->instances_VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, batch->instances_VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(SpriteInstance) * MAX_SPRITE_INSTANCES, NULL, GL_STREAM_DRAW);
+        set_sprite_attributes(0);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
     }
-    // unbind the VAO
-    DEBUG_ASSERT(circle->VAO != 0);
-    glBindVertexArray(0);
-}
+    DEBUG_ASSERT(batch->VAO != 0);
+    bind_vertex_array(0);
 
-static void init_line(Line* line)
-{
-    // Create and bind VAO
-    glGenVertexArrays(1, &line->VAO);
-    glBindVertexArray(line->VAO);
-    {
-        // Vertex position array
-        glGenBuffers(1, &line->vertices_VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, line->vertices_VBO);
-        GLfloat vertices[6] = {0};
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
+    glGenVertexArrays(1, &batch->static_layer_VAO);
+    bind_vertex_array(batch->static_layer_VAO);
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vertices_VBO);
         static const int VERT_POS_LOCATION = 0;
         glVertexAttribPointer(VERT_POS_LOCATION, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(VERT_POS_LOCATION); // enable it, giving the vertex attribute location
+        glEnableVertexAttribArray(VERT_POS_LOCATION);
 
-        // Index array
-        glGenBuffers(1, &line->EBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, line->EBO);
-        const GLuint indices[2] = {0, 1};
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, static_layer.sprites_VBO);
+        set_sprite_attributes(0);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
+    }
+    bind_vertex_array(0);
+}
+
+static void set_line_attributes()
+{
+    static const int VERT_POS_LOCATION = 0;
+    static const int COLOR_LOCATION = 4;
+    glVertexAttribPointer(VERT_POS_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(LineVertex), (void*)offsetof(LineVertex, pos));
+    glVertexAttribPointer(COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(LineVertex), (void*)offsetof(LineVertex, color));
+    glEnableVertexAttribArray(VERT_POS_LOCATION);
+    glEnableVertexAttribArray(COLOR_LOCATION);
+}
+
+static void init_static_layer(StaticLayer* layer)
+{
+    glGenBuffers(1, &layer->instances_VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, layer->instances_VBO);
+    glBufferData(GL_ARRAY_BUFFER, MAX_STATIC_LAYER_INSTANCES * sizeof(ShapeInstance), NULL, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &layer->sprites_VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, layer->sprites_VBO);
+    glBufferData(GL_ARRAY_BUFFER, MAX_STATIC_LAYER_SPRITES * sizeof(SpriteInstance), NULL, GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &layer->lines_VAO);
+    bind_vertex_array(layer->lines_VAO);
+    {
+        glGenBuffers(1, &layer->lines_VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, layer->lines_VBO);
+        glBufferData(GL_ARRAY_BUFFER, MAX_STATIC_LAYER_LINE_VERTICES * sizeof(LineVertex), NULL, GL_STATIC_DRAW);
+        set_line_attributes();
+    }
+    DEBUG_ASSERT(layer->lines_VAO != 0);
+    bind_vertex_array(0);
+}
+
+static void init_line_batch(LineBatch* batch)
+{
+    // Create and bind VAO
+    glGenVertexArrays(1, &batch->VAO);
+    bind_vertex_array(batch->VAO);
+    {
+        // Vertex array, filled in by flush_lines
+        glGenBuffers(1, &batch->vertices_VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, batch->vertices_VBO);
+        glBufferData(GL_ARRAY_BUFFER, 2 * MAX_LINE_VERTICES * sizeof(LineVertex), NULL, GL_STREAM_DRAW);
+        set_line_attributes();
     }
     // unbind the VAO
-    DEBUG_ASSERT(line->VAO != 0);
-    glBindVertexArray(0);
+    DEBUG_ASSERT(batch->VAO != 0);
+    bind_vertex_array(0);
 }
 
 void rendering_init(GameMemory* game_memory, GameRenderInfo* render_info, float width, float height)
@@ -353,148 +889,526 @@ void rendering_init(GameMemory* game_memory, GameRenderInfo* render_info, float
 
     view = Mat4::identity();
 
+    glGenBuffers(1, &camera_UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, camera_UBO);
+    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(Mat4), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, camera_UBO);
+    rendering_set_camera(Vec2(0.0F, 0.0F), 1.0F);
+
     load_shader(game_memory, &sprite_shader, "sprite");
-    
-    // create 1x1 white texture for default/untextured quads
-    unsigned char buf[4] = {255, 255, 255, 255};
-    empty_texture = (Texture*)rendering_create_texture(buf, 1, 1);
-    if (!empty_texture)
+    load_shader(game_memory, &instanced_shader, "instanced");
+    load_shader(game_memory, &circle_shader, "circle");
+    load_shader(game_memory, &line_shader, "line");
+
+    for (int i = MAX_TEXTURES - 1; i >= 0; --i)
     {
-        FATAL_PRINTF("Failed to create empty texture!");
+        textures[i].next_free = free_textures;
+        free_textures = &textures[i];
     }
 
-    init_rect(&global_rect);
-    init_circle(&global_circle);
-    init_line(&global_line);
+    init_line_batch(&line_batch);
+    // before the meshes, which use its instance buffers
+    init_static_layer(&static_layer);
+    init_unit_rect(&instanced_rect);
+    init_sprite_batch(&sprite_batch, &instanced_rect);
+
+    for (int i = 0; i < NUM_SHAPE_BATCHES; ++i)
+    {
+        shape_batches[i].mesh = &instanced_rect;
+    }
+    shape_batches[SHAPE_BATCH_RECT].shader = &instanced_shader;
+    shape_batches[SHAPE_BATCH_RECT_WIREFRAME].shader = &instanced_shader;
+    shape_batches[SHAPE_BATCH_RECT_WIREFRAME].wireframe = true;
+    shape_batches[SHAPE_BATCH_CIRCLE].shader = &circle_shader;
+    shape_batches[SHAPE_BATCH_CIRCLE_WIREFRAME].shader = &circle_shader;
+    shape_batches[SHAPE_BATCH_CIRCLE_WIREFRAME].outline = true;
+
+    // circle edges are antialiased with alpha, everything else is opaque
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
-void rendering_clear_screen(GameRenderInfo* render_info, Color color)
+static void draw_static_layer_runs(StaticLayer* layer);
+
+/*
+ * Gives up on recording the layer that didn't fit. What was recorded is drawn now, and the
+ * batch that didn't fit and everything after it are drawn directly
+ */
+static void overflow_static_layer(StaticLayer* layer)
 {
-    if (render_info->resized)
+    DEBUG_PRINTF("Static layer doesn't fit in its buffers, it won't be cached\n");
+    layer->overflowed = true;
+    layer->recording = false;
+    draw_static_layer_runs(layer);
+}
+
+/*
+ * Adds a run to the static layer, or returns NULL if there's no room for it
+ */
+static StaticLayerRun* add_static_layer_run(StaticLayer* layer)
+{
+    if (layer->num_runs == MAX_STATIC_LAYER_RUNS)
     {
-        float w_width = (float)render_info->window_width;
-        float w_height = (float)render_info->window_height;
-        float aspect = w_width / w_height;
-        if (aspect > GAME_ASPECT)
-        {
-            gl_viewport_height = render_info->window_height;
-            gl_viewport_width = render_info->window_height * GAME_ASPECT;
-            gl_viewport_x = w_width/2.0F - gl_viewport_width/2.0F;
-            gl_viewport_y = 0.0F;
-        }
-        else
-        {
-            gl_viewport_width = render_info->window_width;
-            gl_viewport_height = render_info->window_width / GAME_ASPECT;
-            gl_viewport_x = 0.0F;
-            gl_viewport_y = w_height/2.0F - gl_viewport_height/2.0F;;
-        }
-        glViewport(gl_viewport_x, gl_viewport_y, gl_viewport_width, gl_viewport_height);
-        render_info->resized = false;
-        DEBUG_PRINTF("Resizing viewport (%d, %d)\n", gl_viewport_width, gl_viewport_height);
+        return NULL;
     }
-    glClearColor(color.r, color.g, color.b, color.a);
-    glClear(GL_COLOR_BUFFER_BIT);
+    StaticLayerRun* run = &layer->runs[layer->num_runs++];
+    memset(run, 0, sizeof(StaticLayerRun));
+    return run;
 }
 
-Vec2 rendering_window_pos_to_viewport_pos(int x, int y)
+static bool record_shape_batch(StaticLayer* layer, ShapeBatch* batch)
 {
-    float rescale_factor = 2.0F / (float)gl_viewport_width; // window pixels to game units
-    Vec2 rescale_offset = Vec2{-1.0F, -1.0F};
+    StaticLayerRun* run = NULL;
+    if (!(layer->num_instances + batch->count > MAX_STATIC_LAYER_INSTANCES))
+    {
+        run = add_static_layer_run(layer);
+    }
+    if (!run)
+    {
+        overflow_static_layer(layer);
+        return false;
+    }
+    run->batch = batch;
+    run->first = layer->num_instances;
+    run->count = batch->count;
+
+    glBindBuffer(GL_ARRAY_BUFFER, layer->instances_VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, run->first * sizeof(ShapeInstance), run->count * sizeof(ShapeInstance), batch->instances);
+    layer->num_instances += run->count;
+    return true;
+}
 
-    return Vec2((float)(x - gl_viewport_x), (float)(y - gl_viewport_y)) * rescale_factor + rescale_offset;
+static bool record_lines(StaticLayer* layer, GLenum mode, LineVertex* vertices, uint32_t count)
+{
+    StaticLayerRun* run = NULL;
+    if (!(layer->num_line_vertices + count > MAX_STATIC_LAYER_LINE_VERTICES))
+    {
+        run = add_static_layer_run(layer);
+    }
+    if (!run)
+    {
+        overflow_static_layer(layer);
+        return false;
+    }
+    run->line_mode = mode;
+    run->first = layer->num_line_vertices;
+    run->count = count;
+
+    glBindBuffer(GL_ARRAY_BUFFER, layer->lines_VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, run->first * sizeof(LineVertex), count * sizeof(LineVertex), vertices);
+    layer->num_line_vertices += count;
+    return true;
 }
 
-void rendering_set_camera(Vec2 pos)
+static bool record_sprites(StaticLayer* layer, uint32_t group, SpriteInstance* instances, uint32_t count)
 {
-    view = Mat4::identity().frame_translate(Vec3(pos * (-1.0F), 0.0F));
+    StaticLayerRun* run = NULL;
+    if (!(layer->num_sprites + count > MAX_STATIC_LAYER_SPRITES))
+    {
+        run = add_static_layer_run(layer);
+    }
+    if (!run)
+    {
+        overflow_static_layer(layer);
+        return false;
+    }
+    run->sprites = true;
+    run->sprite_group = group;
+    run->first = layer->num_sprites;
+    run->count = count;
+
+    glBindBuffer(GL_ARRAY_BUFFER, layer->sprites_VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, run->first * sizeof(SpriteInstance), count * sizeof(SpriteInstance), instances);
+    layer->num_sprites += count;
+    return true;
 }
 
-void draw_rect(Vec2 pos, f32 rot, Vec2 size, Texture* tex, GLfloat* tex_coords, Color color, bool wireframe)
+/*
+ * Sets everything for drawing a shape batch's instances except for the VAO
+ */
+static void set_shape_batch_state(ShapeBatch* batch)
 {
-    Rect* rect = &global_rect;
-    Shader* shader = &sprite_shader;
+    use_program(batch->shader->id);
+    if (batch->shader->uniforms[UNIFORM_OUTLINE] != -1)
+    {
+        glUniform1i(batch->shader->uniforms[UNIFORM_OUTLINE], batch->outline);
+    }
+    set_polygon_mode(batch->wireframe);
+    set_blend(batch->shader == &circle_shader);
+}
 
-    GLfloat width_2 = size.x / 2.0F;
-    GLfloat height_2 = size.y / 2.0F;
-    GLfloat vertices[12] = {
-        // top right
-        width_2,    height_2,   0.0F,
-        // top left
-        -width_2,   height_2,   0.0F,
-        // bottom left
-        -width_2,  -height_2,   0.0F,
-        // bottom right
-        width_2,   -height_2,   0.0F,
-    };
+/*
+ * Draws the queued instances of one batch with a single draw call
+ */
+static void flush_shape_batch(ShapeBatch* batch)
+{
+    if (!batch->count)
+    {
+        return;
+    }
+    if (static_layer.recording && record_shape_batch(&static_layer, batch))
+    {
+        batch->count = 0;
+        return;
+    }
+    InstancedMesh* mesh = batch->mesh;
 
-    glBindVertexArray(rect->VAO);
+    bind_vertex_array(mesh->VAO);
     {
-        // Set vertices
-        glBindBuffer(GL_ARRAY_BUFFER, rect->vertices_VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
+        // Set instances, orphaning last draw's buffer rather than waiting for it
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->instances_VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(ShapeInstance) * MAX_SHAPE_INSTANCES, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(ShapeInstance) * batch->count, batch->instances);
 
-        // Set the texture coords
-        glBindBuffer(GL_ARRAY_BUFFER, rect->texture_coords_VBO);
-        glBufferData(GL_ARRAY_BUFFER, RECT_TEX_COORDS_SIZE, tex_coords, GL_STREAM_DRAW);
+        set_shape_batch_state(batch);
 
-        // Set current shader program
-        glUseProgram(shader->id);
+        // draw
+        glDrawElementsInstanced(GL_TRIANGLES, mesh->num_indices, GL_UNSIGNED_INT, 0, batch->count);
+    }
 
-        // Set projection matrix uniform
-        int loc = glGetUniformLocation(shader->id, "projection");
-        glUniformMatrix4fv(loc, 1, GL_FALSE, projection.data);
+    batch->count = 0;
+}
 
-        // Set view matrix uniform
-        loc = glGetUniformLocation(shader->id, "view");
-        glUniformMatrix4fv(loc, 1, GL_FALSE, view.data);
+/*
+ * Draws all queued circles and rects. Called before anything that isn't batched is drawn,
+ * so it still ends up on top of the shapes drawn before it
+ */
+static void flush_shapes()
+{
+    for (int i = 0; i < NUM_SHAPE_BATCHES; ++i)
+    {
+        flush_shape_batch(&shape_batches[i]);
+    }
+}
+
+/*
+ * Draws all queued lines, with at most one draw for thin lines and one for wide ones
+ */
+static void flush_lines()
+{
+    LineBatch* batch = &line_batch;
+    if (!batch->num_thin && !batch->num_wide)
+    {
+        return;
+    }
+    // whatever can't be recorded is drawn
+    if (static_layer.recording && batch->num_thin && record_lines(&static_layer, GL_LINES, batch->thin, batch->num_thin))
+    {
+        batch->num_thin = 0;
+    }
+    if (static_layer.recording && batch->num_wide && record_lines(&static_layer, GL_TRIANGLES, batch->wide, batch->num_wide))
+    {
+        batch->num_wide = 0;
+    }
+    if (!batch->num_thin && !batch->num_wide)
+    {
+        return;
+    }
+    Shader* shader = &line_shader;
 
-        loc = glGetUniformLocation(shader->id, "model");
+    bind_vertex_array(batch->VAO);
+    {
+        // Set vertices, orphaning last draw's buffer rather than waiting for it
+        glBindBuffer(GL_ARRAY_BUFFER, batch->vertices_VBO);
+        glBufferData(GL_ARRAY_BUFFER, 2 * MAX_LINE_VERTICES * sizeof(LineVertex), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, batch->num_thin * sizeof(LineVertex), batch->thin);
+        glBufferSubData(GL_ARRAY_BUFFER, MAX_LINE_VERTICES * sizeof(LineVertex), batch->num_wide * sizeof(LineVertex), batch->wide);
 
-        Mat4 model = Mat4::identity().frame_translate(Vec3(pos, 0.0)).frame_rotate_z(rot);
-        glUniformMatrix4fv(loc, 1, GL_FALSE, model.data);
+        // Set current shader program
+        use_program(shader->id);
+        set_blend(false);
 
-        // Set texture uniform
-        // NOTE for a single texture active texture unit is 0 by default, and uniform is set to that texure unit
-        // each sampler needs a different texture unit
-        glActiveTexture(GL_TEXTURE0);   // texture unit 0
-        glBindTexture(GL_TEXTURE_2D, tex->id);   // bind to texture unit 0
-        loc = glGetUniformLocation(shader->id, "sprite_texture");
-        glUniform1i(loc, GL_TEXTURE0); // put whatevers in texture unit 0 into the uniform sampler
+        // draw
+        if (batch->num_thin)
+        {
+            glDrawArrays(GL_LINES, 0, batch->num_thin);
+        }
+        if (batch->num_wide)
+        {
+            set_polygon_mode(false);
+            glDrawArrays(GL_TRIANGLES, MAX_LINE_VERTICES, batch->num_wide);
+        }
+    }
 
-        // color overlay
-        loc = glGetUniformLocation(shader->id, "color_blend");
-        glUniform4f(loc, color.r, color.g, color.b, color.a);
+    batch->num_thin = 0;
+    batch->num_wide = 0;
+}
 
-        // draw wireframe
-        if (wireframe)
+/*
+ * Sets everything for drawing one group of sprites except for the VAO and instances
+ */
+static void set_sprite_group_state(uint32_t group)
+{
+    use_program(sprite_shader.id);
+    // NOTE the sprite_texture sampler was set to texture unit 0 when the shader was loaded, and
+    // texture unit 0 is always the active one
+    bind_texture(atlas_pages[group % MAX_ATLAS_PAGES].id);
+    set_polygon_mode(group >= MAX_ATLAS_PAGES);
+    set_blend(false);
+}
+
+/*
+ * Draws all queued sprites, with one draw call per page they use
+ */
+static void flush_sprites()
+{
+    SpriteBatch* batch = &sprite_batch;
+    if (!batch->count)
+    {
+        return;
+    }
+
+    // Counting sort by group, keeping the queued order within each group
+    uint32_t group_first[NUM_SPRITE_GROUPS + 1] = {};
+    for (uint32_t i = 0; i < batch->count; ++i)
+    {
+        group_first[batch->groups[i] + 1]++;
+    }
+    for (uint32_t group = 0; group < NUM_SPRITE_GROUPS; ++group)
+    {
+        group_first[group + 1] += group_first[group];
+    }
+    uint32_t group_next[NUM_SPRITE_GROUPS];
+    memcpy(group_next, group_first, sizeof(group_next));
+    for (uint32_t i = 0; i < batch->count; ++i)
+    {
+        batch->sorted[group_next[batch->groups[i]]++] = batch->instances[i];
+    }
+
+    // groups before first_drawn_group were recorded
+    uint32_t first_drawn_group = 0;
+    if (static_layer.recording)
+    {
+        for (; first_drawn_group < NUM_SPRITE_GROUPS; ++first_drawn_group)
         {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            uint32_t count = group_first[first_drawn_group + 1] - group_first[first_drawn_group];
+            if (count && !record_sprites(&static_layer, first_drawn_group, &batch->sorted[group_first[first_drawn_group]], count))
+            {
+                break;
+            }
         }
-        else
+        if (first_drawn_group == NUM_SPRITE_GROUPS)
         {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            batch->count = 0;
+            return;
         }
+    }
 
-        // draw
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    bind_vertex_array(batch->VAO);
+    {
+        // Set instances, orphaning last draw's buffer rather than waiting for it
+        glBindBuffer(GL_ARRAY_BUFFER, batch->instances_VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(SpriteInstance) * MAX_SPRITE_INSTANCES, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(SpriteInstance) * batch->count, batch->sorted);
+
+        for (uint32_t group = first_drawn_group; group < NUM_SPRITE_GROUPS; ++group)
+        {
+            uint32_t count = group_first[group + 1] - group_first[group];
+            if (!count)
+            {
+                continue;
+            }
+            set_sprite_group_state(group);
+            // no base instance in GL 3.3, so the attributes are pointed at the group instead
+            set_sprite_attributes(group_first[group]);
+            glDrawElementsInstanced(GL_TRIANGLES, instanced_rect.num_indices, GL_UNSIGNED_INT, 0, count);
+        }
     }
-    // unbind VAO
-    glBindVertexArray(0);
+
+    batch->count = 0;
 }
 
-void rendering_draw_rect(Vec2 pos, f32 rot, Vec2 size, RenderTexture tex, Color color, bool wireframe)
+static void set_line_vertex(LineVertex* vertex, Vec2 pos, Color color)
 {
-    Texture* texture = (Texture*)tex;
-    if (!texture)
+    vertex->pos[0] = pos.x;
+    vertex->pos[1] = pos.y;
+    vertex->color[0] = color.r;
+    vertex->color[1] = color.g;
+    vertex->color[2] = color.b;
+    vertex->color[3] = color.a;
+}
+
+static void queue_shape(ShapeBatchType type, Vec2 pos, f32 rot, Vec2 size, Color color)
+{
+    ShapeBatch* batch = &shape_batches[type];
+    // lines and sprites queued before this shape have to be drawn under it
+    flush_lines();
+    flush_sprites();
+    if (batch->count == MAX_SHAPE_INSTANCES)
+    {
+        flush_shape_batch(batch);
+    }
+    ShapeInstance* instance = &batch->instances[batch->count++];
+    instance->pos_rot[0] = pos.x;
+    instance->pos_rot[1] = pos.y;
+    instance->pos_rot[2] = rot;
+    instance->size[0] = size.x;
+    instance->size[1] = size.y;
+    instance->color[0] = color.r;
+    instance->color[1] = color.g;
+    instance->color[2] = color.b;
+    instance->color[3] = color.a;
+}
+
+/*
+ * Queues a rect with part of a texture stretched over it. tex_rect is in the texture's own
+ * tex coords, at the rect's bottom left corner then its top right
+ */
+static void queue_sprite(Texture* tex, Vec2 pos, f32 rot, Vec2 size, const f32 tex_rect[4], Color color, bool wireframe)
+{
+    SpriteBatch* batch = &sprite_batch;
+    // shapes and lines queued before this sprite have to be drawn under it
+    flush_shapes();
+    flush_lines();
+    if (batch->count == MAX_SPRITE_INSTANCES)
+    {
+        flush_sprites();
+    }
+    AtlasPage* page = tex->page;
+    batch->groups[batch->count] = (uint8_t)((page - atlas_pages) + (wireframe ? MAX_ATLAS_PAGES : 0));
+    SpriteInstance* instance = &batch->instances[batch->count++];
+    instance->pos_rot[0] = pos.x;
+    instance->pos_rot[1] = pos.y;
+    instance->pos_rot[2] = rot;
+    instance->size[0] = size.x;
+    instance->size[1] = size.y;
+    instance->color[0] = color.r;
+    instance->color[1] = color.g;
+    instance->color[2] = color.b;
+    instance->color[3] = color.a;
+    // texture coords to page coords
+    f32 scale_x = (f32)tex->width / (f32)page->width;
+    f32 scale_y = (f32)tex->height / (f32)page->height;
+    f32 offset_x = (f32)tex->x / (f32)page->width;
+    f32 offset_y = (f32)tex->y / (f32)page->height;
+    instance->tex_rect[0] = offset_x + tex_rect[0] * scale_x;
+    instance->tex_rect[1] = offset_y + tex_rect[1] * scale_y;
+    instance->tex_rect[2] = offset_x + tex_rect[2] * scale_x;
+    instance->tex_rect[3] = offset_y + tex_rect[3] * scale_y;
+}
+
+void rendering_end_frame()
+{
+    flush_shapes();
+    flush_lines();
+    flush_sprites();
+}
+
+/* Passes the oldest pending capture to callback, waiting for it up to timeout_ns. Returns false if it wasn't done */
+static bool finish_capture(RenderCaptureCallback callback, void* user, GLuint64 timeout_ns)
+{
+    CaptureBuffer* buffer = &capture.buffers[(capture.next + NUM_CAPTURE_BUFFERS - capture.num_pending) % NUM_CAPTURE_BUFFERS];
+    GLenum status = glClientWaitSync(buffer->fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout_ns);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        return false;
+    }
+    glDeleteSync(buffer->fence);
+    buffer->fence = 0;
+    capture.num_pending--;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->PBO);
+    void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer->width * buffer->height * 4, GL_MAP_READ_BIT);
+    if (pixels && status != GL_WAIT_FAILED)
     {
-        texture = empty_texture;
+        // GL reads rows from the bottom
+        s64 row_stride = (s64)buffer->width * 4;
+        callback(user, (u8*)pixels + (buffer->height - 1) * row_stride, -row_stride, buffer->width, buffer->height);
     }
     else
     {
-        DEBUG_ASSERT(texture->initialized);
+        DEBUG_PRINTF("ERROR: Failed to read back captured frame\n");
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+bool rendering_capture_frame(RenderCaptureCallback callback, void* user)
+{
+    while (capture.num_pending && finish_capture(callback, user, 0))
+    {
+    }
+    if (capture.num_pending == NUM_CAPTURE_BUFFERS)
+    {
+        return false;
+    }
+
+    CaptureBuffer* buffer = &capture.buffers[capture.next];
+    if (!buffer->PBO)
+    {
+        glGenBuffers(1, &buffer->PBO);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer->PBO);
+    buffer->width = gl_viewport.width;
+    buffer->height = gl_viewport.height;
+    GLsizeiptr size = buffer->width * buffer->height * 4;
+    if (size > buffer->size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        buffer->size = size;
+    }
+    // with a pack buffer bound this only queues the copy
+    glReadPixels(gl_viewport.x, gl_viewport.y, buffer->width, buffer->height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    capture.next = (capture.next + 1) % NUM_CAPTURE_BUFFERS;
+    capture.num_pending++;
+    return true;
+}
+
+void rendering_flush_capture(RenderCaptureCallback callback, void* user)
+{
+    while (capture.num_pending)
+    {
+        finish_capture(callback, user, GL_TIMEOUT_IGNORED);
     }
-    draw_rect(pos, rot, size, texture, (GLfloat*)RECT_DEFAULT_TEX_COORDS, color, wireframe);
+}
+
+void rendering_clear_screen(GameRenderInfo* render_info, Color color)
+{
+    if (render_info->resized)
+    {
+        gl_viewport = RenderViewport::fit_to_window(render_info->window_width, render_info->window_height);
+        glViewport(gl_viewport.x, gl_viewport.y, gl_viewport.width, gl_viewport.height);
+        render_info->resized = false;
+        DEBUG_PRINTF("Resizing viewport (%d, %d)\n", gl_viewport.width, gl_viewport.height);
+    }
+    glClearColor(color.r, color.g, color.b, color.a);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+Vec2 rendering_window_pos_to_viewport_pos(int x, int y)
+{
+    return gl_viewport.window_pos_to_viewport_pos(x, y);
+}
+
+void rendering_set_camera(Vec2 pos, f32 zoom)
+{
+    DEBUG_ASSERT(zoom > 0.0F);
+    view = Mat4::identity().frame_scale(Vec3(zoom, zoom, 1.0F)).frame_translate(Vec3(pos * -zoom, 0.0F));
+    camera_zoom = zoom;
+
+    // shapes, lines and sprites queued so far were meant for the old camera
+    flush_shapes();
+    flush_lines();
+    flush_sprites();
+    glBindBuffer(GL_UNIFORM_BUFFER, camera_UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Mat4), projection.data);
+    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(Mat4), sizeof(Mat4), view.data);
+}
+
+void rendering_draw_rect(Vec2 pos, f32 rot, Vec2 size, RenderTexture tex, Color color, bool wireframe)
+{
+    Texture* texture = (Texture*)tex;
+    if (!texture)
+    {
+        queue_shape(wireframe ? SHAPE_BATCH_RECT_WIREFRAME : SHAPE_BATCH_RECT, pos, rot, size, color);
+        return;
+    }
+    DEBUG_ASSERT(texture->initialized);
+    static const f32 WHOLE_TEXTURE[4] = {0.0F, 0.0F, 1.0F, 1.0F};
+    queue_sprite(texture, pos, rot, size, WHOLE_TEXTURE, color, wireframe);
 }
 
 void rendering_draw_sprite(Vec2 pos, Vec2 size, RenderTexture tex, uint32_t row, uint32_t col, Color color, bool hflip)
@@ -503,7 +1417,6 @@ void rendering_draw_sprite(Vec2 pos, Vec2 size, RenderTexture tex, uint32_t row,
     DEBUG_ASSERT(texture && texture->initialized);
 
     // Compute texture coordinates
-    // combine vertices and texture coords into one buffer
 
     float sprite_frac_width = (float)size.x / (float)texture->width;
     float sprite_frac_height = (float)size.y / (float)texture->height;
@@ -513,134 +1426,154 @@ void rendering_draw_sprite(Vec2 pos, Vec2 size, RenderTexture tex, uint32_t row,
     // jank because we store animations indexed from the top-left, but access the texture in openGL from the bottom-left
     float bottom_left_y = 1.0F - (sprite_frac_height * (row + 1));
 
-    GLfloat texture_coords[RECT_TEX_COORDS_ARRAY_SIZE] = {
-        // top right
-        hflip ? bottom_left_x : bottom_left_x + sprite_frac_width,
-        bottom_left_y + sprite_frac_height,
-        // top left
-        hflip ? bottom_left_x + sprite_frac_width : bottom_left_x,
-        bottom_left_y + sprite_frac_height,
+    f32 tex_rect[4] = {
         // bottom left
         hflip ? bottom_left_x + sprite_frac_width : bottom_left_x,
         bottom_left_y,
-        // bottom right
+        // top right
         hflip ? bottom_left_x : bottom_left_x + sprite_frac_width,
-        bottom_left_y
+        bottom_left_y + sprite_frac_height,
     };
 
-    draw_rect(pos, 0, size, texture, texture_coords, color, false);
+    queue_sprite(texture, pos, 0, size, tex_rect, color, false);
 }
 
 void rendering_draw_line(Vec2 origin, Vec2 point, float width, Color color)
 {
-    Line* line = &global_line;
-    Shader* shader = &sprite_shader;
+    LineBatch* batch = &line_batch;
 
-    GLfloat vertices[6] = {
-        0.0F, 0.0F, 0.0F,
-        point.x, point.y, 0.0F,
-    };
+    // shapes and sprites queued before this line have to be drawn under it
+    flush_shapes();
+    flush_sprites();
 
-    glBindVertexArray(line->VAO);
+    Vec2 end = origin + point;
+    if (width <= 1.0F)
     {
-        // Set vertices
-        glBindBuffer(GL_ARRAY_BUFFER, line->vertices_VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
-
-        // Set current shader program
-        glUseProgram(shader->id);
-
-        // Set projection matrix uniform
-        int loc = glGetUniformLocation(shader->id, "projection");
-        glUniformMatrix4fv(loc, 1, GL_FALSE, projection.data);
-
-        // Set view matrix uniform
-        loc = glGetUniformLocation(shader->id, "view");
-        glUniformMatrix4fv(loc, 1, GL_FALSE, view.data);
-
-        Mat4 model = Mat4::identity().frame_translate(Vec3(origin, 0.0));
-        loc = glGetUniformLocation(shader->id, "model");
-        glUniformMatrix4fv(loc, 1, GL_FALSE, model.data);
-
-        // Set texture uniform
-        // NOTE for a single texture active texture unit is 0 by default, and uniform is set to that texure unit
-        // each sampler needs a different texture unit
-        glActiveTexture(GL_TEXTURE0);   // texture unit 0
-        glBindTexture(GL_TEXTURE_2D, empty_texture->id);   // bind to texture unit 0
-        loc = glGetUniformLocation(shader->id, "sprite_texture");
-        glUniform1i(loc, GL_TEXTURE0); // put whatevers in texture unit 0 into the uniform sampler
-
-        // color overlay
-        loc = glGetUniformLocation(shader->id, "color_blend");
-        glUniform4f(loc, color.r, color.g, color.b, color.a);
+        if (batch->num_thin + 2 > MAX_LINE_VERTICES)
+        {
+            flush_lines();
+        }
+        set_line_vertex(&batch->thin[batch->num_thin++], origin, color);
+        set_line_vertex(&batch->thin[batch->num_thin++], end, color);
+        return;
+    }
 
-        // draw
-        glLineWidth(width);
-        glDrawElements(GL_LINES, 2, GL_UNSIGNED_INT, 0);
+    f32 length = point.length();
+    if (length == 0.0F)
+    {
+        return;
     }
-    // unbind VAO
-    glBindVertexArray(0);
+    if (batch->num_wide + 6 > MAX_LINE_VERTICES)
+    {
+        flush_lines();
+    }
+    // width is in pixels, and the viewport is 2 / zoom game units across
+    f32 half_width = width / ((f32)gl_viewport.width * camera_zoom);
+    Vec2 side = Vec2(-point.y, point.x) * (half_width / length);
+    LineVertex* vertices = &batch->wide[batch->num_wide];
+    set_line_vertex(&vertices[0], origin + side, color);
+    set_line_vertex(&vertices[1], origin - side, color);
+    set_line_vertex(&vertices[2], end - side, color);
+    set_line_vertex(&vertices[3], origin + side, color);
+    set_line_vertex(&vertices[4], end - side, color);
+    set_line_vertex(&vertices[5], end + side, color);
+    batch->num_wide += 6;
 }
 
 void rendering_draw_circle(Vec2 pos, f32 rot, f32 radius, Color color, bool wireframe)
 {
-    Circle* circle = &global_circle;
-    Shader* shader = &sprite_shader;
+    queue_shape(wireframe ? SHAPE_BATCH_CIRCLE_WIREFRAME : SHAPE_BATCH_CIRCLE, pos, rot, Vec2(radius, radius), color);
+}
 
-    // for each point, we need 3 vertices
-    GLfloat vertices[(NUM_CIRCLE_POINTS + 1) * 3] = {};
-    for (int i = 0; i < NUM_CIRCLE_POINTS; i++)
+/*
+ * Draws the recorded runs, in the order they were recorded
+ */
+static void draw_static_layer_runs(StaticLayer* layer)
+{
+    for (uint32_t i = 0; i < layer->num_runs; ++i)
     {
-        int start_i = i * 3;
-        f32 rads = 2.0F*M_PI*(f32)i/(f32)NUM_CIRCLE_POINTS;
-        vertices[start_i + 0] = cosf(rads)*radius; // x
-        vertices[start_i + 1] = sinf(rads)*radius; // y
-        vertices[start_i + 2] = 0; // z
+        StaticLayerRun* run = &layer->runs[i];
+        if (run->batch)
+        {
+            InstancedMesh* mesh = run->batch->mesh;
+            bind_vertex_array(mesh->static_layer_VAO);
+            set_shape_batch_state(run->batch);
+            // no base instance in GL 3.3, so the attributes are pointed at the run instead
+            glBindBuffer(GL_ARRAY_BUFFER, layer->instances_VBO);
+            set_instance_attributes(run->first);
+            glDrawElementsInstanced(GL_TRIANGLES, mesh->num_indices, GL_UNSIGNED_INT, 0, run->count);
+        }
+        else if (run->sprites)
+        {
+            bind_vertex_array(sprite_batch.static_layer_VAO);
+            set_sprite_group_state(run->sprite_group);
+            glBindBuffer(GL_ARRAY_BUFFER, layer->sprites_VBO);
+            set_sprite_attributes(run->first);
+            glDrawElementsInstanced(GL_TRIANGLES, instanced_rect.num_indices, GL_UNSIGNED_INT, 0, run->count);
+        }
+        else
+        {
+            bind_vertex_array(layer->lines_VAO);
+            use_program(line_shader.id);
+            set_polygon_mode(false);
+            set_blend(false);
+            glDrawArrays(run->line_mode, run->first, run->count);
+        }
     }
-    // center is 0
-    vertices[(NUM_CIRCLE_POINTS * 3) + 0] = 0;
-    vertices[(NUM_CIRCLE_POINTS * 3) + 1] = 0;
-    vertices[(NUM_CIRCLE_POINTS * 3) + 2] = 0;
-
-    glBindVertexArray(circle->VAO);
-    {
-        // Set vertices
-        glBindBuffer(GL_ARRAY_BUFFER, circle->vertices_VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
-
-        // Set current shader program
-        glUseProgram(shader->id);
-
-        // Set projection matrix uniform
-        int loc = glGetUniformLocation(shader->id, "projection");
-        glUniformMatrix4fv(loc, 1, GL_FALSE, projection.data);
+}
 
-        // Set view matrix uniform
-        loc = glGetUniformLocation(shader->id, "view");
-        glUniformMatrix4fv(loc, 1, GL_FALSE, view.data);
+bool rendering_begin_static_layer(u32 version)
+{
+    StaticLayer* layer = &static_layer;
 
-        loc = glGetUniformLocation(shader->id, "model");
+    // anything queued so far goes under the layer
+    flush_shapes();
+    flush_lines();
+    flush_sprites();
 
-        Mat4 model = Mat4::identity().frame_translate(Vec3(pos, 0.0)).frame_rotate_z(rot);
-        glUniformMatrix4fv(loc, 1, GL_FALSE, model.data);
+    if (layer->overflowed && layer->version == version)
+    {
+        // too big to cache, so it's just drawn until it changes
+        return true;
+    }
+    if (layer->valid &&
+        layer->version == version &&
+        layer->viewport_width == gl_viewport.width &&
+        layer->zoom == camera_zoom)
+    {
+        return false;
+    }
 
-        // color overlay
-        loc = glGetUniformLocation(shader->id, "color_blend");
-        glUniform4f(loc, color.r, color.g, color.b, color.a);
+    layer->valid = false;
+    layer->recording = true;
+    layer->overflowed = false;
+    layer->version = version;
+    layer->viewport_width = gl_viewport.width;
+    layer->zoom = camera_zoom;
+    layer->num_instances = 0;
+    layer->num_line_vertices = 0;
+    layer->num_sprites = 0;
+    layer->num_runs = 0;
+    return true;
+}
 
-        // draw wireframe
-        if (wireframe)
-        {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        }
-        else
-        {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        }
+void rendering_end_static_layer()
+{
+    StaticLayer* layer = &static_layer;
 
-        // draw
-        glDrawElements(GL_TRIANGLES, NUM_CIRCLE_POINTS * 3, GL_UNSIGNED_INT, 0);
+    // records what's still queued, or draws it if the layer overflowed
+    flush_shapes();
+    flush_lines();
+    flush_sprites();
+    if (layer->overflowed)
+    {
+        // already drawn, as it went
+        return;
     }
-    // unbind VAO
-    glBindVertexArray(0);
-}
\ No newline at end of file
+    if (layer->recording)
+    {
+        layer->recording = false;
+        layer->valid = true;
+    }
+    draw_static_layer_runs(layer);
+}
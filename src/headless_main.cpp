@@ -0,0 +1,226 @@
+/*
+ * This file contains the entry point for the headless platform layer.
+ * It has no window or input devices; it replays an input recording as fast as possible.
+ */
+
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<time.h>
+#endif
+
+#include"game_platform_interface.h"
+#include"input_recording.h"
+#include"histogram.h"
+#include"platform_memory.h"
+#if defined(RENDERER_SOFTWARE)
+#include"sw_rendering.h"
+#elif defined(RENDERER_NULL)
+#include"null_rendering.h"
+#endif
+
+// Stuff passed to game
+static GameMemory game_memory{};
+static GameInputBuffer game_input_buffer{};
+static GameRenderInfo game_render_info;
+
+static u64 get_time_ns()
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (u64)((f64)counter.QuadPart * 1e9 / (f64)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+#endif
+}
+
+#ifdef RENDERER_SOFTWARE
+/* Writes the software renderer's last frame to <prefix><frame>.ppm */
+static void write_frame(const char* prefix, u64 frame)
+{
+    int width, height;
+    u32* pixels = sw_rendering_get_framebuffer(&width, &height);
+    if (!pixels)
+        return;
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s%06llu.ppm", prefix, (unsigned long long)frame);
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        FATAL_PRINTF("Couldn't open \"%s\"\n", path);
+    }
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    u8* row = (u8*)malloc((size_t)width * 3);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            u32 pixel = pixels[y * width + x];
+            row[x * 3 + 0] = (u8)pixel;
+            row[x * 3 + 1] = (u8)(pixel >> 8);
+            row[x * 3 + 2] = (u8)(pixel >> 16);
+        }
+        fwrite(row, 3, width, file);
+    }
+    free(row);
+    fclose(file);
+}
+#endif // RENDERER_SOFTWARE
+
+#ifdef RENDERER_NULL
+/* Per frame averages of the game's rendering calls, which the null renderer only counts */
+static void print_render_calls(u64 num_frames)
+{
+    RenderCallCounts counts = null_rendering_get_call_counts();
+    f64 frames = num_frames ? (f64)num_frames : 1.0;
+    printf("render calls per frame: rect %.1f circle %.1f sprite %.1f line %.1f camera %.1f clear %.1f static layer %.1f end %.1f\n",
+           (f64)counts.draw_rect / frames,
+           (f64)counts.draw_circle / frames,
+           (f64)counts.draw_sprite / frames,
+           (f64)counts.draw_line / frames,
+           (f64)counts.set_camera / frames,
+           (f64)counts.clear_screen / frames,
+           (f64)counts.static_layers / frames,
+           (f64)counts.end_frame / frames);
+    printf("textures: create %llu replace %llu destroy %llu\n",
+           (unsigned long long)counts.create_texture,
+           (unsigned long long)counts.replace_texture,
+           (unsigned long long)counts.destroy_texture);
+}
+#endif // RENDERER_NULL
+
+int main(int argc, char* args[])
+{
+    const char* replay_path = NULL;
+    GameMemoryOptions memory_options = {};
+#ifdef RENDERER_SOFTWARE
+    const char* frames_prefix = NULL;
+#endif
+#ifdef RENDERER_NULL
+    bool render_calls = false;
+#endif
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(args[i], "--scene") && i + 2 < argc
+            && args[i + 1][0] >= '0' && args[i + 1][0] <= '9' && args[i + 1][1] == '\0')
+        {
+            game_memory.scene_paths[args[i + 1][0] - '0'] = args[i + 2];
+            i += 2;
+        }
+        else if (!strcmp(args[i], "--trace") && i + 1 < argc)
+        {
+            game_memory.trace_path = args[++i];
+        }
+        else if (!strcmp(args[i], "--stats") && i + 1 < argc)
+        {
+            game_memory.stats_path = args[++i];
+        }
+        else if (!strcmp(args[i], "--pages") && i + 1 < argc
+                 && platform_parse_game_memory_pages(args[i + 1], &memory_options.pages))
+        {
+            ++i;
+        }
+        else if (!strcmp(args[i], "--prefault"))
+        {
+            memory_options.prefault = true;
+        }
+#ifdef RENDERER_SOFTWARE
+        else if (!strcmp(args[i], "--frames") && i + 1 < argc)
+        {
+            frames_prefix = args[++i];
+        }
+#endif
+#ifdef RENDERER_NULL
+        else if (!strcmp(args[i], "--render-calls"))
+        {
+            render_calls = true;
+        }
+#endif
+        else if (!replay_path && args[i][0] != '-')
+        {
+            replay_path = args[i];
+        }
+        else
+        {
+            replay_path = NULL;
+            break;
+        }
+    }
+    if (!replay_path)
+    {
+#if defined(RENDERER_SOFTWARE)
+        fprintf(stderr, "usage: %s [--scene <slot 0-9> <file>]... [--trace <file>] [--stats <file>] [--frames <path prefix>] [--pages default|huge|transparent] [--prefault] <input recording>\n", args[0]);
+#elif defined(RENDERER_NULL)
+        fprintf(stderr, "usage: %s [--scene <slot 0-9> <file>]... [--trace <file>] [--stats <file>] [--render-calls] [--pages default|huge|transparent] [--prefault] <input recording>\n", args[0]);
+#else
+        fprintf(stderr, "usage: %s [--scene <slot 0-9> <file>]... [--trace <file>] [--stats <file>] [--pages default|huge|transparent] [--prefault] <input recording>\n", args[0]);
+#endif
+        return 1;
+    }
+
+    InputPlayback playback;
+    if (!input_playback_begin(&playback, replay_path))
+    {
+        fprintf(stderr, "Couldn't replay \"%s\"\n", replay_path);
+        return 1;
+    }
+
+    // init game memory
+    game_memory.memory_size = GIBIBYTES(1);
+    game_memory.memory = platform_alloc_game_memory(game_memory.memory_size, &memory_options);
+    if (!game_memory.memory)
+    {
+        fprintf(stderr, "Couldn't allocate game memory\n");
+        return 1;
+    }
+
+    game_init_memory(&game_memory, &game_render_info);
+
+    // init game input
+    memset(&game_input_buffer, 0, sizeof(GameInputBuffer));
+
+    // no frame limiting; the recorded dts are all the game needs
+    Histogram frame_histogram;
+    histogram_init(&frame_histogram, "frame");
+    u64 start_time = get_time_ns();
+    while (input_playback_read_frame(&playback, &game_input_buffer, &game_render_info))
+    {
+        u64 frame_start_time = get_time_ns();
+        game_update_and_render(&game_memory, &game_input_buffer, &game_render_info);
+        histogram_record(&frame_histogram, get_time_ns() - frame_start_time);
+#ifdef RENDERER_SOFTWARE
+        // not counted in the frame times, it's much slower than the frame
+        if (frames_prefix)
+        {
+            write_frame(frames_prefix, frame_histogram.count - 1);
+        }
+#endif
+    }
+    u64 end_time = get_time_ns();
+
+    u64 num_frames = playback.num_frames;
+    f64 total_ms = (f64)(end_time - start_time) / 1e6;
+    printf("replayed %llu frames in %.3f ms (%.4f ms/frame, %.1f frames/s)\n",
+           (unsigned long long)num_frames,
+           total_ms,
+           num_frames ? total_ms / (f64)num_frames : 0.0,
+           total_ms > 0.0 ? (f64)num_frames * 1000.0 / total_ms : 0.0);
+    histogram_print(&frame_histogram, stdout);
+#ifdef RENDERER_NULL
+    if (render_calls)
+    {
+        print_render_calls(num_frames);
+    }
+#endif
+
+    game_shutdown(&game_memory);
+    input_playback_end(&playback);
+    platform_free_game_memory(game_memory.memory, game_memory.memory_size);
+
+    return 0;
+}
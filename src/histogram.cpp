@@ -0,0 +1,93 @@
+/*
+ * Log-linear histograms, see histogram.h
+ */
+#include"histogram.h"
+
+#ifdef _MSC_VER
+#include<intrin.h>
+#endif
+
+static u32 highest_bit(u64 value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (u32)index;
+#else
+    return 63 - (u32)__builtin_clzll(value);
+#endif
+}
+
+static u32 bucket_index(u64 value)
+{
+    if (value < HISTOGRAM_SUB_BUCKETS)
+    {
+        return (u32)value;
+    }
+    /* keep the top HISTOGRAM_SUB_BUCKET_BITS bits; the top one is always set, so there are half as many buckets */
+    u32 shift = highest_bit(value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+    return shift * (HISTOGRAM_SUB_BUCKETS / 2) + (u32)(value >> shift);
+}
+
+static u64 bucket_highest_value(u32 index)
+{
+    if (index < HISTOGRAM_SUB_BUCKETS)
+    {
+        return index;
+    }
+    u32 shift = index / (HISTOGRAM_SUB_BUCKETS / 2) - 1;
+    u64 sub_bucket = index - shift * (HISTOGRAM_SUB_BUCKETS / 2);
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void histogram_init(Histogram* histogram, const char* name)
+{
+    memset(histogram, 0, sizeof(Histogram));
+    histogram->name = name;
+    histogram->min = UINT64_MAX;
+}
+
+void histogram_record(Histogram* histogram, u64 value_ns)
+{
+    histogram->buckets[bucket_index(value_ns)]++;
+    histogram->count++;
+    if (value_ns < histogram->min)
+        histogram->min = value_ns;
+    if (value_ns > histogram->max)
+        histogram->max = value_ns;
+}
+
+u64 histogram_percentile(Histogram* histogram, f64 fraction)
+{
+    if (!histogram->count)
+    {
+        return 0;
+    }
+
+    u64 rank = (u64)(fraction * (f64)histogram->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    u64 seen = 0;
+    for (u32 i = 0; i < HISTOGRAM_NUM_BUCKETS; ++i)
+    {
+        seen += histogram->buckets[i];
+        if (seen >= rank)
+        {
+            /* the bucket's top end could be past the largest value actually recorded */
+            u64 value = bucket_highest_value(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void histogram_print(Histogram* histogram, FILE* file)
+{
+    fprintf(file, "%-10s n %-8llu p50 %8.3f  p95 %8.3f  p99 %8.3f  max %8.3f ms\n",
+            histogram->name,
+            (unsigned long long)histogram->count,
+            (f64)histogram_percentile(histogram, 0.50) / 1e6,
+            (f64)histogram_percentile(histogram, 0.95) / 1e6,
+            (f64)histogram_percentile(histogram, 0.99) / 1e6,
+            (f64)histogram->max / 1e6);
+}
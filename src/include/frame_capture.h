@@ -0,0 +1,41 @@
+#ifndef FRAME_CAPTURE_H
+/*
+ * Writing captured frames (see rendering_capture_frame) to image files on a background thread.
+ * frame_capture_add only copies the frame into one of a few spare buffers and queues it, so
+ * encoding and writing never hold up the frame. Frames are dropped if the encoder falls far
+ * enough behind that there are no spare buffers.
+ * Used by the platform layers only.
+ */
+
+#include"util.h"
+
+enum FrameCaptureFormat
+{
+    FRAME_CAPTURE_PNG,      // one PNG per frame, <path>000000.png onwards
+    FRAME_CAPTURE_RAW,      // RGBA8 frames appended to one file, for ffmpeg -f rawvideo
+};
+
+struct FrameCapture
+{
+    FrameCaptureFormat format;
+    const char* path;
+    FILE* raw_file;
+    int width;                  // of the first frame, raw frames of another size are dropped
+    int height;
+    u64 num_frames;             // queued to be written
+    u64 num_dropped;
+    bool wait_for_buffers;      // wait for the encoder instead of dropping, when frame times don't matter
+    struct FrameCaptureEncoder* encoder;
+};
+
+/* Formats by path: raw if it ends in ".raw", otherwise PNGs with path as the prefix */
+bool frame_capture_begin(FrameCapture* capture, const char* path);
+/* A RenderCaptureCallback, with the FrameCapture as user */
+void frame_capture_add(void* capture, const u8* first_row, s64 row_stride, int width, int height);
+/* Counts a frame the renderer couldn't capture as dropped */
+void frame_capture_drop(FrameCapture* capture);
+/* Waits for the queued frames to be written */
+void frame_capture_end(FrameCapture* capture);
+
+#define FRAME_CAPTURE_H
+#endif
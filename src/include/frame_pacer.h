@@ -0,0 +1,36 @@
+#ifndef FRAME_PACER_H
+/*
+ * Frame pacing by sleeping until absolute deadlines.
+ * Deadlines are a fixed period apart, so time spent on one frame's work doesn't push the
+ * following frames later. The OS sleep wakes up spin_ns early and spins the rest of the
+ * way; spin_ns tracks how late the sleeps have recently been, so the spin stays short.
+ * Used by the platform layers only.
+ */
+
+#include"util.h"
+
+enum FramePacing
+{
+    FRAME_PACING_SLEEP,     // sleep to the frame deadline, no vsync
+    FRAME_PACING_VSYNC,     // block in the buffer swap only
+};
+
+struct FramePacer
+{
+    u64 period_ns;
+    u64 deadline_ns;        // end of the current frame
+    u64 spin_ns;            // how early to wake up from the OS sleep
+    void* timer;            // waitable timer on Windows
+};
+
+void frame_pacer_init(FramePacer* pacer, u64 period_ns);
+/*
+ * Waits for the end of the current frame, and sets how far past it that was.
+ * Returns false if the frame was already over, without waiting
+ */
+bool frame_pacer_wait(FramePacer* pacer, u64* overshoot_ns);
+void frame_pacer_end(FramePacer* pacer);
+u64 frame_pacer_time_ns();
+
+#define FRAME_PACER_H
+#endif
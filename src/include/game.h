@@ -1,8 +1,13 @@
 #ifndef GAME_H
 #include"linear_algebra.h"
 #include"game_math.h"
+#include"game_platform_interface.h"
+#include"rendering.h"
+#include"triple_buffer.h"
 
-#define MAX_OBJS 128
+#define MAX_OBJS 65536
+/* Scratch space for pairs and collisions found in one frame */
+#define MAX_COLL_PAIRS (1 << 20)
 
 struct AABB {
     Vec2 min;
@@ -99,28 +104,125 @@ struct Collision
     Vec2 normal; /* from obj 0 to 1 */
 };
 
+/* Mouse wheel steps to zoom in 2x, and how far out and in the camera goes */
+#define CAMERA_ZOOM_STEPS_PER_DOUBLING 4
+#define CAMERA_MIN_ZOOM_STEPS (-4 * CAMERA_ZOOM_STEPS_PER_DOUBLING)
+#define CAMERA_MAX_ZOOM_STEPS (6 * CAMERA_ZOOM_STEPS_PER_DOUBLING)
+
 struct GameState
 {
+    /* Camera */
     Vec2 camera_pos;
-    Obj objs[MAX_OBJS];
+    s32 camera_zoom_steps;      // zoom is 2^(steps/CAMERA_ZOOM_STEPS_PER_DOUBLING), so zeroed state is 1x
+    bool camera_dragging;
+    Vec2 camera_grab_pos;       // the game point kept under the mouse while dragging
     bool paused;
 
     /* Physics */
-    Obj *p_coll_pairs[MAX_OBJS * MAX_OBJS][2]; // potential
-    Collision collisions[MAX_OBJS * MAX_OBJS];
     Vec2 mouse_force_origin;
     bool mouse_dragging;
+
+    u32 num_objs; // objs past this are unused
+    Obj objs[MAX_OBJS];
+
+    Obj *add_obj(Obj obj)
+    {
+        DEBUG_ASSERT(num_objs < MAX_OBJS);
+        objs[num_objs] = obj;
+        return &objs[num_objs++];
+    }
 };
 
 void physics_update(GameState *game_state, f32 dt);
 
+/* Collision kernels */
+/* World space corners of a rect, counter clockwise from top right */
+void get_rect_verts(Obj *rect, Vec2 *ret);
+/* Separating axis test between two convex polygons */
+bool polys_colliding_sat(Obj *objs[2], Vec2 *verts[2], u32 num_verts[2], Collision *collision);
+/* Fills in collision and returns true if the pair is overlapping */
+bool get_collision(Obj **pair, Collision *collision);
+
+/* Empties a game state */
+void clear_game_state(GameState *game_state);
+
+/* Loads a scene file into a game state. See scene_file.h */
+bool load_scene(GameState *game_state, const char *filename);
+
+/* What the renderer needs of a body */
+struct RenderObj
+{
+    Vec2 pos;
+    f32 rot;
+    Vec2 size;      // radius in x for circles
+    Color color;
+    u32 is_rect;
+    u32 wireframe;
+    u32 is_static;
+};
+
+struct RenderContact
+{
+    Vec2 points[2];
+    Vec2 normal;
+};
+
+/* Contacts are debug drawing, only this many are kept */
+#define MAX_RENDER_CONTACTS 4096
+
+/*
+ * Everything game_render draws, copied out at the end of game_update.
+ * The simulation can run on another thread, so rendering never looks at game state
+ */
+struct RenderSnapshot
+{
+    Vec2 camera_pos;
+    f32 camera_zoom;
+    f32 dt;
+    u32 static_version;     // changes whenever the static bodies might have
+
+    bool mouse_dragging;
+    bool mouse_force_on;
+    Vec2 mouse_pos;
+    Vec2 mouse_force_origin;
+
+    u32 num_contacts;
+    RenderContact contacts[MAX_RENDER_CONTACTS];
+
+    u32 num_objs;
+    RenderObj objs[MAX_OBJS];
+};
+
+/* "RBSCHKPT", marks a block that can be resumed from a checkpoint file */
+#define GAME_CHECKPOINT_MAGIC 0x54504B4843534252ULL
+
 // Just for destructuring game memory buffer
 struct GameMemoryBlock
 {
+    /* Checked before resuming from memory mapped back in from a checkpoint, see game_init_memory */
+    u64 checkpoint_magic;
+    u64 checkpoint_size;                    // sizeof(GameMemoryBlock) when it was written
+    GameMemoryBlock* checkpoint_address;    // the pointers in it are only good at the same address
+    bool shut_down_cleanly;                 // not left mid-frame
+
     GameState *game_state;
     u32 curr_state_i;
-    GameState game_states[10]; // one per number key
-    GameState initial_game_states[10]; // one per number key
+    GameState game_states[GAME_NUM_SCENE_SLOTS]; // one per number key
+    GameState initial_game_states[GAME_NUM_SCENE_SLOTS]; // one per number key
+
+    /* Physics scratch, only used for the current game state */
+    Obj *p_coll_pairs[MAX_COLL_PAIRS][2]; // potential
+    Collision collisions[MAX_COLL_PAIRS];
+
+    /* Results of the last simulated frame that aren't in the game state */
+    u32 num_collisions;
+    Vec2 mouse_pos;
+    bool mouse_force_on;
+    u32 static_version;     // bumped on scene switch and reset, see rendering_begin_static_layer
+
+    /* Written by game_update, read by game_render, see triple_buffer.h */
+    TripleBuffer snapshot_buffer;
+    RenderSnapshot snapshots[3];
 };
 
 #define GAME_H
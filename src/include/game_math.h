@@ -17,6 +17,18 @@
 int clamp(int val, int lo, int hi);
 float clamp(float val, float lo, float hi);
 
+/* Small, fast PRNG (xorshift64*). Unlike <random>, sequences are the same on every platform */
+struct RandomGenerator
+{
+    u64 state;
+
+    RandomGenerator(u64 seed);
+    u32 next_u32();
+    f32 next_f32(); // [0, 1)
+    f32 range(f32 lo, f32 hi); // [lo, hi)
+    u32 range(u32 lo, u32 hi); // [lo, hi] inclusive
+};
+
 struct PerlinNoiseGenerator
 {
     int p[512];
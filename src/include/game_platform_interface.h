@@ -40,9 +40,13 @@ struct GameInput
     bool mouse_right_down;
     bool mouse_middle_down;
 
-    // wheel
+    // wheel steps scrolled since startup, positive away from the user; the game looks at the change
     s32 mouse_wheel_scrolled;
 
+    // size of the window the mouse pointer position is in
+    s32 window_width;
+    s32 window_height;
+
     // keys
     bool up;
     bool down;
@@ -55,9 +59,19 @@ struct GameInput
     bool _1;
     bool _2;
     bool _3;
+    bool _4;
+    bool _5;
+    bool _6;
+    bool _7;
+    bool _8;
+    bool _9;
+    bool _0;
 
     bool space;
     bool esc;
+
+    bool f1;    // profiler overlay
+    bool f2;    // start/stop trace capture
 };
 
 struct GameInputBuffer
@@ -78,22 +92,59 @@ struct GameInputBuffer
         DEBUG_ASSERT(offset < INPUT_BUFFER_SIZE);
         return &(buffer[(last + INPUT_BUFFER_SIZE - offset) % INPUT_BUFFER_SIZE]);
     }
+    // advance to the next input, starting from a copy of the previous one
+    // (otherwise keys only fire on each keyboard event bounded by OS repeat rate)
+    inline GameInput* advance()
+    {
+        uint32_t prev = last;
+        last = (last + 1) % INPUT_BUFFER_SIZE;
+        buffer[last] = buffer[prev];
+        // TODO for now these dts are the same as we only poll once a frame
+        buffer[last].dt = dt;
+        return &(buffer[last]);
+    }
 };
 
 void *DEBUG_platform_read_entire_file(const char *filename, s64 *returned_size);
 char *DEBUG_platform_read_entire_file_as_string(const char *filename, s64 *returned_size);
 void DEBUG_platform_free_file_memory(void *memory);
+/* Map a file read-only; the memory is valid until it's unmapped */
+void *DEBUG_platform_map_file(const char *filename, s64 *returned_size);
+void DEBUG_platform_unmap_file(void *memory, s64 size);
+
+// one game state per number key
+static const int GAME_NUM_SCENE_SLOTS = 10;
 
 struct GameMemory
 {
     void* (*platform_gl_get_proc_address)(const char*);
 
+    // scene files to load into each slot instead of the built in scenes; NULL for the default
+    const char* scene_paths[GAME_NUM_SCENE_SLOTS];
+    // capture a trace of every frame to this file; NULL to only capture when toggled
+    const char* trace_path;
+    // log per-frame physics stats to this file; NULL for none
+    const char* stats_path;
+
     unsigned memory_size;
     void* memory;
+    // memory holds what was left in it by the last run, mapped back in from a checkpoint file,
+    // rather than zeros. The game picks up where that run left off if it can
+    bool memory_restored;
 };
 
 void game_init_memory(GameMemory* game_memory, GameRenderInfo* render_info);
+/*
+ * game_update steps the simulation and game_render draws the last state it finished.
+ * They can be called from different threads, as long as each is only ever called from one;
+ * rendering calls are only made from game_render.
+ */
+void game_update(GameMemory* game_memory, GameInputBuffer* input_buffer);
+void game_render(GameMemory* game_memory, GameRenderInfo* render_info);
+/* Both, one after the other */
 void game_update_and_render(GameMemory* game_memory, GameInputBuffer* input_buffer, GameRenderInfo* render_info);
+/* Finishes anything that's still being written out */
+void game_shutdown(GameMemory* game_memory);
 
 #define GAME_PLATFORM_INTERFACE_H
 #endif
\ No newline at end of file
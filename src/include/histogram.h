@@ -0,0 +1,34 @@
+#ifndef HISTOGRAM_H
+/*
+ * Log-linear (HDR style) histograms of durations, for latency percentiles.
+ * Each power of two range is split into HISTOGRAM_SUB_BUCKETS / 2 linear buckets, so a
+ * recorded value is off by at most 1 / (HISTOGRAM_SUB_BUCKETS / 2) from the true value,
+ * from nanoseconds up to hours, in a fixed amount of memory.
+ * Used by the platform layers only.
+ */
+
+#include"util.h"
+
+#define HISTOGRAM_SUB_BUCKET_BITS 7
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+/* Values below HISTOGRAM_SUB_BUCKETS get a bucket each; every power of two above that gets half as many */
+#define HISTOGRAM_NUM_BUCKETS ((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * (HISTOGRAM_SUB_BUCKETS / 2) + HISTOGRAM_SUB_BUCKETS / 2)
+
+struct Histogram
+{
+    const char* name;
+    u64 count;
+    u64 min;
+    u64 max;
+    u32 buckets[HISTOGRAM_NUM_BUCKETS];
+};
+
+void histogram_init(Histogram* histogram, const char* name);
+void histogram_record(Histogram* histogram, u64 value_ns);
+/* Highest value in the bucket the given fraction (0..1) of recorded values are at or under */
+u64 histogram_percentile(Histogram* histogram, f64 fraction);
+/* One line: count, p50, p95, p99 and max in milliseconds */
+void histogram_print(Histogram* histogram, FILE* file);
+
+#define HISTOGRAM_H
+#endif
@@ -0,0 +1,62 @@
+#ifndef INPUT_RECORDING_H
+/*
+ * Recording and playback of game input.
+ * The input buffer (and window size) is all the game sees from the platform each frame,
+ * so replaying a recording from startup reproduces a session exactly.
+ * Used by the platform layer only.
+ */
+
+#include"game_platform_interface.h"
+
+/* File layout: InputRecordingHeader, followed by one InputRecordingFrame per frame */
+static const u32 INPUT_RECORDING_MAGIC = 0x52534252; // "RBSR"
+/*
+ * Bumped whenever the game reads recorded input differently, not just when the layout changes.
+ * 1: first version
+ * 2: the wheel zooms the camera and right or middle drag pans it
+ */
+static const u32 INPUT_RECORDING_VERSION = 2;
+
+struct InputRecordingHeader
+{
+    u32 magic;
+    u32 version;
+    u32 frame_size;     // sizeof(InputRecordingFrame) when the file was written
+    u32 reserved;
+};
+
+struct InputRecordingFrame
+{
+    f32 dt;
+    s32 mouse_x;
+    s32 mouse_y;
+    s32 mouse_wheel_scrolled;
+    u16 window_width;
+    u16 window_height;
+    u32 buttons;        // one bit per bool in GameInput, see input_recording.cpp
+};
+
+struct InputRecording
+{
+    FILE* file;
+    u64 num_frames;
+};
+
+bool input_recording_begin(InputRecording* recording, const char* filename);
+/* Append the input for the frame about to be run */
+void input_recording_write_frame(InputRecording* recording, GameInputBuffer* input_buffer);
+void input_recording_end(InputRecording* recording);
+
+struct InputPlayback
+{
+    FILE* file;
+    u64 num_frames;
+};
+
+bool input_playback_begin(InputPlayback* playback, const char* filename);
+/* Advance the input buffer and fill it from the next recorded frame. Returns false at the end of the recording */
+bool input_playback_read_frame(InputPlayback* playback, GameInputBuffer* input_buffer, GameRenderInfo* render_info);
+void input_playback_end(InputPlayback* playback);
+
+#define INPUT_RECORDING_H
+#endif
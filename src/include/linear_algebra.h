@@ -2,6 +2,16 @@
 #include"util.h"
 #include"game_math.h"
 
+// SSE is always there on x64, AVX only when built for it (-mavx, /arch:AVX)
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include<xmmintrin.h>
+#define LINEAR_ALGEBRA_SSE
+#endif
+#ifdef __AVX__
+#include<immintrin.h>
+#define LINEAR_ALGEBRA_AVX
+#endif
+
 struct Vec2
 {
     float x;
@@ -138,7 +148,8 @@ struct Vec4
     }
 };
 
-struct Mat4
+// aligned so each column can be loaded into an SSE register in one go
+struct alignas(16) Mat4
 {
     static const int SIZE = 4;
     // stored with contiguous vectors layed out next to each other
@@ -214,10 +225,46 @@ struct Mat4
         return ret;
     }
 
+    /*
+     * Each column of the result is this matrix's columns, weighted by that column of m. The SIMD
+     * versions start from zero and add in the same order as the loops, so they give the same
+     * results, down to the sign of zeros
+     */
     Mat4 operator*(const Mat4& m)
     {
-        // TODO this faster
         Mat4 ret;
+#if defined(LINEAR_ALGEBRA_AVX)
+        // two columns of the result at a time
+        __m256 col0 = _mm256_broadcast_ps((const __m128*)&data[0 * SIZE]);
+        __m256 col1 = _mm256_broadcast_ps((const __m128*)&data[1 * SIZE]);
+        __m256 col2 = _mm256_broadcast_ps((const __m128*)&data[2 * SIZE]);
+        __m256 col3 = _mm256_broadcast_ps((const __m128*)&data[3 * SIZE]);
+        for (int c = 0; c < SIZE; c += 2)
+        {
+            const float* a = &m.data[c * SIZE];
+            const float* b = &m.data[(c + 1) * SIZE];
+            __m256 sum = _mm256_add_ps(_mm256_setzero_ps(), _mm256_mul_ps(col0, _mm256_setr_ps(a[0], a[0], a[0], a[0], b[0], b[0], b[0], b[0])));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(col1, _mm256_setr_ps(a[1], a[1], a[1], a[1], b[1], b[1], b[1], b[1])));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(col2, _mm256_setr_ps(a[2], a[2], a[2], a[2], b[2], b[2], b[2], b[2])));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(col3, _mm256_setr_ps(a[3], a[3], a[3], a[3], b[3], b[3], b[3], b[3])));
+            // Mat4 is only 16 byte aligned
+            _mm256_storeu_ps(&ret.data[c * SIZE], sum);
+        }
+#elif defined(LINEAR_ALGEBRA_SSE)
+        __m128 col0 = _mm_load_ps(&data[0 * SIZE]);
+        __m128 col1 = _mm_load_ps(&data[1 * SIZE]);
+        __m128 col2 = _mm_load_ps(&data[2 * SIZE]);
+        __m128 col3 = _mm_load_ps(&data[3 * SIZE]);
+        for (int c = 0; c < SIZE; ++c)
+        {
+            const float* weights = &m.data[c * SIZE];
+            __m128 sum = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(col0, _mm_set1_ps(weights[0])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(col1, _mm_set1_ps(weights[1])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(col2, _mm_set1_ps(weights[2])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(col3, _mm_set1_ps(weights[3])));
+            _mm_store_ps(&ret.data[c * SIZE], sum);
+        }
+#else
         for (int c = 0; c < SIZE; ++c)
         {
             for (int r = 0; r < SIZE; ++r)
@@ -228,14 +275,22 @@ struct Mat4
                 }
             }
         }
+#endif
         return ret;
     }
 
     Vec4 operator*(const Vec4& v)
     {
-        // TODO this faster
-        float v_data[4] = {v.x, v.y, v.z, v.w};
         Vec4 ret;
+#if defined(LINEAR_ALGEBRA_SSE)
+        __m128 sum = _mm_add_ps(_mm_setzero_ps(), _mm_mul_ps(_mm_load_ps(&data[0 * SIZE]), _mm_set1_ps(v.x)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&data[1 * SIZE]), _mm_set1_ps(v.y)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&data[2 * SIZE]), _mm_set1_ps(v.z)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&data[3 * SIZE]), _mm_set1_ps(v.w)));
+        // Vec4 isn't aligned
+        _mm_storeu_ps(&ret.x, sum);
+#else
+        float v_data[4] = {v.x, v.y, v.z, v.w};
         for (int i = 0; i < SIZE; ++i)
         {
             ret.x += (data[i * SIZE + 0] * v_data[i]);
@@ -243,6 +298,7 @@ struct Mat4
             ret.z += (data[i * SIZE + 2] * v_data[i]);
             ret.w += (data[i * SIZE + 3] * v_data[i]);
         }
+#endif
         return ret;
     }
 
@@ -311,6 +367,19 @@ struct Mat4
         return ret;
     }
 
+    // Scales each axis of the coord frame separately
+    Mat4 frame_scale(Vec3 factors)
+    {
+        Mat4 ret(data);
+        for (int i = 0; i < 3; ++i)
+        {
+            ret.data[0 + i] *= factors.x;
+            ret.data[4 + i] *= factors.y;
+            ret.data[8 + i] *= factors.z;
+        }
+        return ret;
+    }
+
     Mat4 frame_rotate_z(f32 theta)
     {
         float r_mat_data[] = {cosf(theta),  sinf(theta), 0, 0,
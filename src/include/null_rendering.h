@@ -0,0 +1,28 @@
+#ifndef NULL_RENDERING_H
+/*
+ * Extra calls for platform layers built with the null renderer (-DRENDERER_NULL), which draws
+ * nothing so that frames cost only the simulation and the game's draw submission
+ */
+#include"util.h"
+
+/* How many times each rendering.h call was made */
+struct RenderCallCounts
+{
+    u64 clear_screen;
+    u64 set_camera;
+    u64 draw_rect;
+    u64 draw_circle;
+    u64 draw_sprite;
+    u64 draw_line;
+    u64 create_texture;
+    u64 replace_texture;
+    u64 destroy_texture;
+    u64 static_layers;      // begin_static_layer
+    u64 end_frame;
+};
+
+/* Counts since startup. Counting is always on, it's one add per call */
+RenderCallCounts null_rendering_get_call_counts();
+
+#define NULL_RENDERING_H
+#endif
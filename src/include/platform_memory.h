@@ -0,0 +1,45 @@
+#ifndef PLATFORM_MEMORY_H
+/*
+ * Allocating the block of memory the game runs in, shared by the platform layers that don't
+ * need anything from SDL. Used by the platform layers only.
+ */
+
+#include"util.h"
+
+enum GameMemoryPages
+{
+    GAME_MEMORY_PAGES_DEFAULT,      // whatever the OS gives, 4 KiB pages on x86
+    GAME_MEMORY_PAGES_HUGE,         // explicit huge pages, from the pool reserved for them (MAP_HUGETLB, MEM_LARGE_PAGES)
+    GAME_MEMORY_PAGES_TRANSPARENT,  // default pages the kernel is asked to back with huge ones (MADV_HUGEPAGE), Linux only
+};
+
+struct GameMemoryOptions
+{
+    GameMemoryPages pages;          // set to the pages actually used by platform_alloc_game_memory
+    bool prefault;                  // fault every page in up front, rather than on first touch in the first frames
+    u64 address;                    // where to put it, 0 for anywhere. Set to 0 if it had to go elsewhere
+    /*
+     * File the memory is mapped from, so it's left with whatever the game last wrote, to be
+     * mapped back in by the next run. NULL for memory that starts zeroed and goes with the
+     * process. Files can't be backed by huge pages
+     */
+    const char* backing_path;
+    bool restored;                  // set if the backing file already held memory from an earlier run
+};
+
+/*
+ * Falls back from huge to transparent to default pages when the ones asked for aren't
+ * available, and to anywhere if address is taken, unless it's backed by a file (the pointers
+ * in it would be no good elsewhere). Returns NULL if the memory couldn't be allocated at all
+ */
+void* platform_alloc_game_memory(u64 size, GameMemoryOptions* options);
+/* Writes file backed memory back to its file, waiting until it's done. Does nothing for other memory */
+void platform_sync_game_memory(void* memory, u64 size);
+void platform_free_game_memory(void* memory, u64 size);
+
+/* Parses "default", "huge" or "transparent" */
+bool platform_parse_game_memory_pages(const char* name, GameMemoryPages* pages);
+const char* platform_game_memory_pages_name(GameMemoryPages pages);
+
+#define PLATFORM_MEMORY_H
+#endif
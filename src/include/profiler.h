@@ -0,0 +1,126 @@
+#ifndef PROFILER_H
+/*
+ * Per-phase frame profiler
+ * Scoped timers read the CPU timestamp counter. Each phase's self time (not counting
+ * phases nested inside it) is added to the current frame, and the last
+ * PROFILER_NUM_FRAMES frames are kept in a ring buffer for the on-screen graph.
+ * Build with -DPROFILER to enable it; otherwise it all compiles to nothing.
+ */
+#include"util.h"
+
+enum ProfilePhase
+{
+    PROFILE_FORCES,     // compute forces and integrate
+    PROFILE_AABB,       // update AABBs
+    PROFILE_BROAD,      // broad phase pairs
+    PROFILE_NARROW,     // narrow phase tests
+    PROFILE_TOI,        // time of impact search for colliding pairs
+    PROFILE_SOLVE,      // collision impulses
+    PROFILE_RENDER,     // render submission
+    PROFILE_NUM_PHASES,
+};
+
+#ifdef PROFILER
+
+#include<atomic>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include<intrin.h>
+#else
+#include<x86intrin.h>
+#endif
+inline u64 profiler_ticks()
+{
+    return __rdtsc();
+}
+#else
+#include<chrono>
+inline u64 profiler_ticks()
+{
+    return (u64)std::chrono::steady_clock::now().time_since_epoch().count();
+}
+#endif
+
+#define PROFILER_NUM_FRAMES 128
+
+/*
+ * Frames are started by the simulation, but phases can be timed on any thread (render is on
+ * the main thread when the simulation has its own), so everything shared is atomic
+ */
+struct ProfileFrame
+{
+    std::atomic<u64> start;
+    std::atomic<u64> ticks;     // start of this frame to the start of the next
+    std::atomic<u64> phase_ticks[PROFILE_NUM_PHASES];
+};
+
+struct Profiler
+{
+    ProfileFrame frames[PROFILER_NUM_FRAMES];
+    std::atomic<u32> curr;      // frame being recorded
+    std::atomic<f64> ticks_per_second;
+    std::atomic<bool> show_overlay;
+    std::atomic<bool> tracing;  // a trace capture is running, see trace.h
+};
+
+extern Profiler profiler;
+
+/* Defined in trace.cpp */
+void trace_phase(ProfilePhase phase, u64 start, u64 ticks);
+
+struct ProfileScope
+{
+    ProfilePhase phase;
+    u64 start;
+    u64 child_ticks;
+    ProfileScope *parent;
+
+    static thread_local ProfileScope *current;
+
+    ProfileScope(ProfilePhase phase) : phase(phase), child_ticks(0), parent(current)
+    {
+        current = this;
+        start = profiler_ticks();
+    }
+    ~ProfileScope()
+    {
+        u64 elapsed = profiler_ticks() - start;
+        profiler.frames[profiler.curr].phase_ticks[phase] += elapsed - child_ticks;
+        if (profiler.tracing)
+        {
+            trace_phase(phase, start, elapsed);
+        }
+        if (parent)
+        {
+            parent->child_ticks += elapsed;
+        }
+        current = parent;
+    }
+};
+
+#define PROFILE_CONCAT_(A, B) A##B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT_(A, B)
+/* Times the rest of the enclosing block as the given phase */
+#define PROFILE_SCOPE(PHASE) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(PHASE)
+
+/* Ends the previous frame and starts recording a new one */
+void profiler_begin_frame();
+/* Measures the tick rate now instead of over the first frames */
+void profiler_calibrate();
+void profiler_toggle_overlay();
+/* Bar graph of the last frames' phase times; frame_budget_s is drawn at half the graph height */
+void profiler_draw_overlay(f32 frame_budget_s);
+
+#else // PROFILER
+
+#define PROFILE_SCOPE(PHASE)
+
+inline void profiler_begin_frame() {}
+inline void profiler_toggle_overlay() {}
+inline void profiler_draw_overlay(f32 frame_budget_s) {}
+
+#endif // else PROFILER
+
+#define PROFILER_H
+#endif
@@ -10,19 +10,68 @@ struct Color
     float a;
 };
 
+/* Region of the window the game is drawn in, letterboxed to the game's aspect ratio */
+struct RenderViewport
+{
+    int x;
+    int y;
+    int width;
+    int height;
+
+    static RenderViewport fit_to_window(int window_width, int window_height)
+    {
+        const float game_aspect = (float)GAME_WIDTH_PX/(float)GAME_HEIGHT_PX;
+        float w_width = (float)window_width;
+        float w_height = (float)window_height;
+        float aspect = w_width / w_height;
+        RenderViewport ret;
+        if (aspect > game_aspect)
+        {
+            ret.height = window_height;
+            ret.width = window_height * game_aspect;
+            ret.x = w_width/2.0F - ret.width/2.0F;
+            ret.y = 0;
+        }
+        else
+        {
+            ret.width = window_width;
+            ret.height = window_width / game_aspect;
+            ret.x = 0;
+            ret.y = w_height/2.0F - ret.height/2.0F;
+        }
+        return ret;
+    }
+
+    /* Convert a pixel coord in window space to viewport space */
+    Vec2 window_pos_to_viewport_pos(int window_x, int window_y)
+    {
+        float rescale_factor = 2.0F / (float)width; // window pixels to game units
+        Vec2 rescale_offset = Vec2{-1.0F, -1.0F};
+
+        return Vec2((float)(window_x - x), (float)(window_y - y)) * rescale_factor + rescale_offset;
+    }
+};
+
 void rendering_init(GameMemory* game_memory, GameRenderInfo* render_info, float width, float height);
 
 /* Convert a pixel coord in window space to viewport space */
 Vec2 rendering_window_pos_to_viewport_pos(int x, int y);
 
-/* Texture handle must be created before use */
+/*
+ * Texture handle must be created before use. Image data is RGBA8, width * height pixels.
+ * Small textures are packed together into shared atlas pages, so textured rects and sprites
+ * using any of the textures on a page cost one draw between them
+ */
 typedef void* RenderTexture;
 RenderTexture rendering_create_texture(void* image_data, uint32_t width, uint32_t height);
 void rendering_replace_texture(RenderTexture tex, void* image_data);
+/* The handle and its space can be reused by the next create, so don't draw it after this */
+void rendering_destroy_texture(RenderTexture tex);
 
 void rendering_clear_screen(GameRenderInfo* render_info, Color color);
 
-void rendering_set_camera(Vec2 pos);
+/* The view is 2 / zoom game units across, centred on pos */
+void rendering_set_camera(Vec2 pos, f32 zoom);
 
 /* Pos is centre of rect. Texture is optional, and will be stretched across the rect */
 void rendering_draw_rect(Vec2 pos, f32 rot, Vec2 size, RenderTexture tex, Color color, bool wireframe);
@@ -36,6 +85,39 @@ void rendering_draw_sprite(Vec2 pos, Vec2 size, RenderTexture tex, uint32_t row,
 
 void rendering_draw_line(Vec2 origin, Vec2 point, float width, Color color);
 
+/*
+ * Draws between these are recorded once and drawn again from static buffers, for things that
+ * don't change from frame to frame. Pass a new version whenever they do.
+ * Begin returns false while the recorded layer is still good, and the draws should be skipped;
+ * end draws the layer either way. The camera can pan without invalidating it, but a new zoom
+ * redraws it, since wide lines are sized in pixels
+ */
+bool rendering_begin_static_layer(u32 version);
+void rendering_end_static_layer();
+
+/*
+ * Rects, circles, lines and sprites are queued and drawn together; this draws whatever is still
+ * queued. Call after the last draw of the frame. Textured draws are drawn page by page, so ones
+ * on different atlas pages can overlap in a different order to the one they were made in
+ */
+void rendering_end_frame();
+
+/*
+ * Gets captured frames: the game viewport as width x height RGBA8 pixels. first_row is the top
+ * row, and each row is row_stride bytes after the one above it (negative if stored bottom up).
+ * The pixels are only valid during the call
+ */
+typedef void (*RenderCaptureCallback)(void* user, const u8* first_row, s64 row_stride, int width, int height);
+
+/*
+ * Starts reading back the frame just drawn, without waiting for it, and passes any earlier
+ * frames that have finished reading back to callback, oldest first. Call after rendering_end_frame.
+ * Returns false if the frame was skipped because too many are still being read back
+ */
+bool rendering_capture_frame(RenderCaptureCallback callback, void* user);
+/* Waits for the frames still being read back and passes them to callback, to end a capture */
+void rendering_flush_capture(RenderCaptureCallback callback, void* user);
+
 //void rendering_draw_point(Vec2 pos, float size, Color color);
 
 /* Pos is bottom left corner of text */
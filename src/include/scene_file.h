@@ -0,0 +1,32 @@
+#ifndef SCENE_FILE_H
+/*
+ * Binary scene format
+ * Bodies are stored exactly as they are laid out in GameState::objs, so a mapped
+ * scene file can be used in place, or copied into a game state with one memcpy.
+ *
+ * Layout: SceneFileHeader, padding up to objs_offset, then num_objs Objs
+ */
+#include"game.h"
+
+static const u32 SCENE_FILE_MAGIC = 0x43534252; // "RBSC"
+// bump this whenever Obj changes
+static const u32 SCENE_FILE_VERSION = 1;
+// keeps the bodies cache line aligned in a mapped file
+static const u32 SCENE_FILE_OBJS_OFFSET = 64;
+
+struct SceneFileHeader
+{
+    u32 magic;
+    u32 version;
+    u32 obj_size;       // sizeof(Obj) when the file was written
+    u32 num_objs;
+    u64 objs_offset;    // from the start of the file
+};
+
+/* Returns the bodies in a scene file already in memory, or NULL if it isn't a valid scene for this build */
+Obj *scene_file_objs(void *data, s64 size, u32 *num_objs);
+
+bool scene_file_write(const char *filename, Obj *objs, u32 num_objs);
+
+#define SCENE_FILE_H
+#endif
@@ -0,0 +1,50 @@
+#ifndef SCENE_GEN_H
+/*
+ * Procedurally generated stress scenes, for benchmarking
+ * The same params (including the seed) always generate the same scene
+ */
+#include"game.h"
+
+struct SceneGenParams
+{
+    u32 seed;
+
+    /* Bodies are packed on a jittered grid in the region, without overlapping */
+    u32 num_bodies;
+    Vec2 region_min;
+    Vec2 region_max;
+    f32 rect_fraction;      // 0..1, the rest are circles
+    f32 static_fraction;    // 0..1, the rest are dynamic
+    /* Size is the radius of a circle or half the longest side of a rect, shrunk if needed to fit the grid */
+    f32 min_size;
+    f32 max_size;
+    f32 size_skew;          // 1 is uniform, > 1 favours small bodies, < 1 favours large ones
+
+    /* Initial velocities follow a noise flow field */
+    f32 max_speed;
+    f32 max_angular_speed;
+    f32 flow_frequency;     // higher is more turbulent
+
+    /* Static terrain under the region, with heights from noise */
+    u32 terrain_segments;   // 0 for none
+    f32 terrain_height;
+    f32 terrain_frequency;  // higher is rougher
+
+    bool walls;             // static box around everything
+};
+
+enum SceneGenPreset
+{
+    SCENE_GEN_PACKED_CIRCLES,   // lots of small circles in a box
+    SCENE_GEN_MIXED_TERRAIN,    // circles and rects of varied sizes, some static, over terrain
+    SCENE_GEN_FLOW_FIELD,       // fast moving circles and rects, swirling
+    SCENE_GEN_NUM_PRESETS,
+};
+
+SceneGenParams scene_gen_preset(SceneGenPreset preset, u32 seed);
+
+/* Replaces the contents of a game state with a generated scene. Returns false if it doesn't fit */
+bool scene_gen_generate(GameState *game_state, SceneGenParams *params);
+
+#define SCENE_GEN_H
+#endif
@@ -0,0 +1,56 @@
+#ifndef STATS_LOG_H
+/*
+ * Per-frame physics statistics log
+ * The game appends one PhysicsFrameStats per simulated frame, so counts can be lined up
+ * against frame times and compared between runs and builds. stats_dump turns a log into CSV.
+ */
+
+#include"util.h"
+
+/* File layout: StatsLogHeader, followed by one PhysicsFrameStats per frame */
+static const u32 STATS_LOG_MAGIC = 0x54534252; // "RBST"
+static const u32 STATS_LOG_VERSION = 1;
+
+struct StatsLogHeader
+{
+    u32 magic;
+    u32 version;
+    u32 frame_size;     // sizeof(PhysicsFrameStats) when the file was written
+    u32 reserved;
+};
+
+/* Only append fields, older logs are read with the fields they have */
+struct PhysicsFrameStats
+{
+    u32 frame;              // frames since startup, paused frames aren't logged
+    u32 live_bodies;        // bodies that exist, static or not
+    u32 pairs;              // broad phase AABB pairs, summed over the collision iterations
+    u32 collisions;         // collisions resolved (coll_num)
+    u32 iterations;         // collision detection iterations (iter)
+    u32 collision_tests;    // get_collision calls, including the time of impact search
+    u32 invariant_failures; // pairs colliding at the start or end of the frame
+};
+
+struct StatsLog
+{
+    FILE* file;
+    u64 num_frames;
+};
+
+bool stats_log_begin(StatsLog* log, const char* filename);
+void stats_log_write_frame(StatsLog* log, PhysicsFrameStats* stats);
+void stats_log_end(StatsLog* log);
+
+struct StatsLogReader
+{
+    FILE* file;
+    u32 frame_size;
+};
+
+bool stats_log_open(StatsLogReader* reader, const char* filename);
+/* Fields the file doesn't have are zeroed. Returns false at the end of the log */
+bool stats_log_read_frame(StatsLogReader* reader, PhysicsFrameStats* stats);
+void stats_log_close(StatsLogReader* reader);
+
+#define STATS_LOG_H
+#endif
@@ -0,0 +1,15 @@
+#ifndef SW_RENDERING_H
+/*
+ * Extra calls for platform layers built with the software renderer (-DRENDERER_SOFTWARE),
+ * which draws into memory instead of a window
+ */
+#include"util.h"
+
+/*
+ * The frame finished by the last rendering_end_frame, as RGBA8 pixels in rows from the top.
+ * Window sized, with the game letterboxed in it like the GL renderer
+ */
+u32* sw_rendering_get_framebuffer(int* width, int* height);
+
+#define SW_RENDERING_H
+#endif
@@ -0,0 +1,48 @@
+#ifndef TRACE_H
+/*
+ * Chrome trace event capture
+ * While a capture is running, every profiler scope becomes a complete ("X") event on
+ * its thread's track, each frame gets a "frame" event, and TRACE_COUNTER values become
+ * counter tracks. The file is JSON in the trace event format, which opens in Perfetto
+ * (ui.perfetto.dev) or chrome://tracing.
+ * Part of the profiler: without -DPROFILER it all compiles to nothing.
+ */
+#include"profiler.h"
+
+enum TraceCounter
+{
+    TRACE_PAIRS,        // AABB pairs found by the broad phase, per collision iteration
+    TRACE_COLLISIONS,   // collisions resolved this frame
+    TRACE_ITERATIONS,   // collision detection iterations this frame
+    TRACE_NUM_COUNTERS,
+};
+
+#ifdef PROFILER
+
+/* Starts writing events to a new file, ending any capture already running */
+bool trace_begin(const char *filename);
+/* Writes out the buffered events and closes the file */
+void trace_end();
+bool trace_active();
+
+/* Name for the calling thread's track; the string must outlive the capture */
+void trace_set_thread_name(const char *name);
+
+void trace_counter(TraceCounter counter, u64 value);
+void trace_frame(u64 start, u64 ticks);
+
+#define TRACE_COUNTER(COUNTER, VALUE) do { if (profiler.tracing) trace_counter(COUNTER, VALUE); } while(false)
+
+#else // PROFILER
+
+#define TRACE_COUNTER(COUNTER, VALUE)
+
+inline bool trace_begin(const char *filename) { return false; }
+inline void trace_end() {}
+inline bool trace_active() { return false; }
+inline void trace_set_thread_name(const char *name) {}
+
+#endif // else PROFILER
+
+#define TRACE_H
+#endif
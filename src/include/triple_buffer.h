@@ -0,0 +1,51 @@
+#ifndef TRIPLE_BUFFER_H
+/*
+ * Lock-free triple buffer indices, for one writer thread handing the latest of a stream of
+ * items (e.g. render snapshots) to one reader thread.
+ * The writer always has a buffer to write to and the reader always has a complete one to
+ * read; the third is handed between them with a single atomic exchange. Neither side ever
+ * waits, and the reader skips items it was too slow to see.
+ * Zeroed memory is not a valid state, call triple_buffer_init.
+ */
+#include<atomic>
+
+#include"util.h"
+
+struct TripleBuffer
+{
+    /* Set in shared when it holds an item the reader hasn't taken yet */
+    static const u32 FRESH = 4;
+
+    u32 write;                  // owned by the writer
+    std::atomic<u32> shared;    // the one in between
+    u32 read;                   // owned by the reader
+};
+
+inline void triple_buffer_init(TripleBuffer* buffer)
+{
+    buffer->write = 0;
+    buffer->shared.store(1, std::memory_order_relaxed);
+    buffer->read = 2;
+}
+
+/* Hands the buffer at buffer->write to the reader, and takes another one to write next */
+inline void triple_buffer_publish(TripleBuffer* buffer)
+{
+    u32 prev = buffer->shared.exchange(buffer->write | TripleBuffer::FRESH, std::memory_order_acq_rel);
+    buffer->write = prev & ~TripleBuffer::FRESH;
+}
+
+/* Swaps buffer->read for the newest published buffer. Returns false if nothing new was published */
+inline bool triple_buffer_acquire(TripleBuffer* buffer)
+{
+    if (!(buffer->shared.load(std::memory_order_relaxed) & TripleBuffer::FRESH))
+    {
+        return false;
+    }
+    u32 prev = buffer->shared.exchange(buffer->read, std::memory_order_acq_rel);
+    buffer->read = prev & ~TripleBuffer::FRESH;
+    return true;
+}
+
+#define TRIPLE_BUFFER_H
+#endif
@@ -9,6 +9,7 @@
 #include<stdint.h>
 #include<limits.h>
 #include<string.h>
+#include<stddef.h>
 
 static_assert(CHAR_BIT == 8, "Char must be 8 bits");
 
@@ -0,0 +1,185 @@
+/*
+ * Input recording and playback, shared by the platform layers
+ */
+#include"input_recording.h"
+
+/*
+ * Bit i of InputRecordingFrame::buttons is input_bits[i]
+ * Only append to this list; reordering it breaks old recordings
+ */
+static bool GameInput::* const input_bits[] = {
+    &GameInput::mouse_left_down,
+    &GameInput::mouse_right_down,
+    &GameInput::mouse_middle_down,
+    &GameInput::up,
+    &GameInput::down,
+    &GameInput::left,
+    &GameInput::right,
+    &GameInput::r,
+    &GameInput::p,
+    &GameInput::_1,
+    &GameInput::_2,
+    &GameInput::_3,
+    &GameInput::space,
+    &GameInput::esc,
+    &GameInput::_4,
+    &GameInput::_5,
+    &GameInput::_6,
+    &GameInput::_7,
+    &GameInput::_8,
+    &GameInput::_9,
+    &GameInput::_0,
+    &GameInput::f1,
+    &GameInput::f2,
+};
+static_assert(SIZE_OF_ARRAY(input_bits) <= sizeof(u32) * BITS_PER_BYTE, "Too many buttons for InputRecordingFrame");
+
+bool input_recording_begin(InputRecording* recording, const char* filename)
+{
+    recording->num_frames = 0;
+    recording->file = fopen(filename, "wb");
+    if (!recording->file)
+    {
+        DEBUG_PRINTF("Couldn't open \"%s\" for recording\n", filename);
+        return false;
+    }
+
+    InputRecordingHeader header = {};
+    header.magic = INPUT_RECORDING_MAGIC;
+    header.version = INPUT_RECORDING_VERSION;
+    header.frame_size = sizeof(InputRecordingFrame);
+    if (fwrite(&header, sizeof(header), 1, recording->file) != 1)
+    {
+        DEBUG_PRINTF("Couldn't write recording header\n");
+        fclose(recording->file);
+        recording->file = NULL;
+        return false;
+    }
+
+    DEBUG_PRINTF("Recording input to \"%s\"\n", filename);
+    return true;
+}
+
+void input_recording_write_frame(InputRecording* recording, GameInputBuffer* input_buffer)
+{
+    if (!recording->file)
+    {
+        return;
+    }
+
+    GameInput* input = input_buffer->last_input();
+    InputRecordingFrame frame = {};
+    frame.dt = input_buffer->dt;
+    frame.mouse_x = input->mouse_x;
+    frame.mouse_y = input->mouse_y;
+    frame.mouse_wheel_scrolled = input->mouse_wheel_scrolled;
+    frame.window_width = (u16)input->window_width;
+    frame.window_height = (u16)input->window_height;
+    for (u32 i = 0; i < SIZE_OF_ARRAY(input_bits); ++i)
+    {
+        frame.buttons |= (u32)(input->*input_bits[i]) << i;
+    }
+
+    if (fwrite(&frame, sizeof(frame), 1, recording->file) != 1)
+    {
+        DEBUG_PRINTF("Couldn't write recording frame %llu, stopping recording\n", (unsigned long long)recording->num_frames);
+        input_recording_end(recording);
+        return;
+    }
+    recording->num_frames++;
+}
+
+void input_recording_end(InputRecording* recording)
+{
+    if (!recording->file)
+    {
+        return;
+    }
+    fclose(recording->file);
+    recording->file = NULL;
+    DEBUG_PRINTF("Recorded %llu frames\n", (unsigned long long)recording->num_frames);
+}
+
+bool input_playback_begin(InputPlayback* playback, const char* filename)
+{
+    playback->num_frames = 0;
+    playback->file = fopen(filename, "rb");
+    if (!playback->file)
+    {
+        DEBUG_PRINTF("Couldn't open recording \"%s\"\n", filename);
+        return false;
+    }
+
+    InputRecordingHeader header;
+    if (fread(&header, sizeof(header), 1, playback->file) != 1
+        || header.magic != INPUT_RECORDING_MAGIC)
+    {
+        DEBUG_PRINTF("\"%s\" is not an input recording\n", filename);
+        input_playback_end(playback);
+        return false;
+    }
+    if (header.version < INPUT_RECORDING_VERSION)
+    {
+        // the game would read its input differently, so it wouldn't play back the same
+        DEBUG_PRINTF("\"%s\" was recorded by an older build (version %u, expected %u), record it again\n", filename, header.version, INPUT_RECORDING_VERSION);
+        input_playback_end(playback);
+        return false;
+    }
+    if (header.version != INPUT_RECORDING_VERSION || header.frame_size != sizeof(InputRecordingFrame))
+    {
+        DEBUG_PRINTF("Unsupported input recording version %u (expected %u)\n", header.version, INPUT_RECORDING_VERSION);
+        input_playback_end(playback);
+        return false;
+    }
+
+    DEBUG_PRINTF("Replaying input from \"%s\"\n", filename);
+    return true;
+}
+
+bool input_playback_read_frame(InputPlayback* playback, GameInputBuffer* input_buffer, GameRenderInfo* render_info)
+{
+    if (!playback->file)
+    {
+        return false;
+    }
+
+    InputRecordingFrame frame;
+    if (fread(&frame, sizeof(frame), 1, playback->file) != 1)
+    {
+        return false;
+    }
+
+    input_buffer->dt = frame.dt;
+    GameInput* input = input_buffer->advance();
+    memset(input, 0, sizeof(GameInput));
+    input->dt = frame.dt;
+    input->mouse_x = frame.mouse_x;
+    input->mouse_y = frame.mouse_y;
+    input->mouse_wheel_scrolled = frame.mouse_wheel_scrolled;
+    input->window_width = frame.window_width;
+    input->window_height = frame.window_height;
+    for (u32 i = 0; i < SIZE_OF_ARRAY(input_bits); ++i)
+    {
+        input->*input_bits[i] = (frame.buttons >> i) & 1;
+    }
+
+    if (frame.window_width != render_info->window_width || frame.window_height != render_info->window_height)
+    {
+        render_info->window_width = frame.window_width;
+        render_info->window_height = frame.window_height;
+        render_info->resized = true;
+    }
+
+    playback->num_frames++;
+    return true;
+}
+
+void input_playback_end(InputPlayback* playback)
+{
+    if (!playback->file)
+    {
+        return;
+    }
+    fclose(playback->file);
+    playback->file = NULL;
+}
@@ -1,6 +1,3 @@
-// TODO remove
-#include<random>
-
 #include"game_math.h"
 
 int clamp(int val, int lo, int hi)
@@ -17,12 +14,47 @@ float clamp(float val, float lo, float hi)
     return val;
 }
 
+RandomGenerator::RandomGenerator(u64 seed)
+{
+    /* splitmix64 the seed, so similar seeds give unrelated sequences (and state is never 0) */
+    u64 z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    state = z ? z : 1;
+}
+
+u32 RandomGenerator::next_u32()
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (u32)((state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+f32 RandomGenerator::next_f32()
+{
+    /* top 24 bits, so every value is exactly representable */
+    return (f32)(next_u32() >> 8) * (1.0F / 16777216.0F);
+}
+
+f32 RandomGenerator::range(f32 lo, f32 hi)
+{
+    return lo + (hi - lo) * next_f32();
+}
+
+u32 RandomGenerator::range(u32 lo, u32 hi)
+{
+    DEBUG_ASSERT(lo <= hi);
+    u64 span = (u64)hi - (u64)lo + 1;
+    return lo + (u32)(((u64)next_u32() * span) >> 32);
+}
+
 PerlinNoiseGenerator::PerlinNoiseGenerator(u32 seed)
 {
     int i, j;
 
-    std::mt19937 generator(seed); 
-    /* std::uniform_real_distribution<f32> real_distribution(-1.0, 1.0); */
+    RandomGenerator generator(seed);
 
     for (i = 0; i < 256; ++i)
     {
@@ -45,11 +77,13 @@ PerlinNoiseGenerator::PerlinNoiseGenerator(u32 seed)
     /* permute the sequence */
     for (i = 0; i < 255; ++i)
     {
-        std::uniform_int_distribution<int> int_distribution(i, 255); /* inclusive */
-        j = int_distribution(generator);
+        j = (int)generator.range((u32)i, 255U); /* inclusive */
         int tmp = p[i];
         p[i] = p[j];
         p[j] = tmp;
+    }
+    for (i = 0; i < 256; ++i)
+    {
         p[i + 256] = p[i]; // copy array over itself
     }
 }
@@ -0,0 +1,133 @@
+/*
+ * Implementation of rendering.h that draws nothing, for builds without a window or GL context.
+ * It only counts the calls, see null_rendering.h
+ */
+#include"rendering.h"
+#include"null_rendering.h"
+
+struct NullTexture
+{
+    uint32_t width;
+    uint32_t height;
+    NullTexture* next_free;
+};
+
+static const int MAX_TEXTURES = 4096;
+static NullTexture textures[MAX_TEXTURES];
+static int num_textures = 0;        // used at least once, the rest have never been handed out
+static NullTexture* free_textures;  // destroyed, linked through next_free
+
+// Still tracked, so mouse input maps to the same game coordinates as with a real renderer
+static RenderViewport viewport = {0, 0, GAME_WIDTH_PX, GAME_HEIGHT_PX};
+
+static RenderCallCounts call_counts;
+
+void rendering_init(GameMemory* game_memory, GameRenderInfo* render_info, float width, float height)
+{
+}
+
+RenderCallCounts null_rendering_get_call_counts()
+{
+    return call_counts;
+}
+
+Vec2 rendering_window_pos_to_viewport_pos(int x, int y)
+{
+    return viewport.window_pos_to_viewport_pos(x, y);
+}
+
+RenderTexture rendering_create_texture(void* image_data, uint32_t width, uint32_t height)
+{
+    call_counts.create_texture++;
+    NullTexture* ret = free_textures;
+    if (ret)
+    {
+        free_textures = ret->next_free;
+    }
+    else if (num_textures < MAX_TEXTURES)
+    {
+        ret = &textures[num_textures++];
+    }
+    else
+    {
+        DEBUG_PRINTF("ERROR: Failed to allocate texture\n");
+        return NULL;
+    }
+    ret->width = width;
+    ret->height = height;
+    return ret;
+}
+
+void rendering_replace_texture(RenderTexture tex, void* image_data)
+{
+    call_counts.replace_texture++;
+}
+
+void rendering_destroy_texture(RenderTexture _tex)
+{
+    call_counts.destroy_texture++;
+    NullTexture* tex = (NullTexture*)_tex;
+    tex->next_free = free_textures;
+    free_textures = tex;
+}
+
+void rendering_clear_screen(GameRenderInfo* render_info, Color color)
+{
+    call_counts.clear_screen++;
+    if (render_info->resized)
+    {
+        viewport = RenderViewport::fit_to_window(render_info->window_width, render_info->window_height);
+        render_info->resized = false;
+    }
+}
+
+void rendering_set_camera(Vec2 pos, f32 zoom)
+{
+    call_counts.set_camera++;
+}
+
+void rendering_draw_rect(Vec2 pos, f32 rot, Vec2 size, RenderTexture tex, Color color, bool wireframe)
+{
+    call_counts.draw_rect++;
+}
+
+void rendering_draw_circle(Vec2 pos, f32 rot, f32 radius, Color color, bool wireframe)
+{
+    call_counts.draw_circle++;
+}
+
+void rendering_draw_sprite(Vec2 pos, Vec2 size, RenderTexture tex, uint32_t row, uint32_t col, Color color, bool hflip)
+{
+    call_counts.draw_sprite++;
+}
+
+void rendering_draw_line(Vec2 origin, Vec2 point, float width, Color color)
+{
+    call_counts.draw_line++;
+}
+
+void rendering_end_frame()
+{
+    call_counts.end_frame++;
+}
+
+/* Nothing is cached, so the layer's draws are made, and counted, every frame like the rest */
+bool rendering_begin_static_layer(u32 version)
+{
+    call_counts.static_layers++;
+    return true;
+}
+
+void rendering_end_static_layer()
+{
+}
+
+/* There are no frames to capture */
+bool rendering_capture_frame(RenderCaptureCallback callback, void* user)
+{
+    return false;
+}
+
+void rendering_flush_capture(RenderCaptureCallback callback, void* user)
+{
+}
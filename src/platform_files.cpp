@@ -0,0 +1,133 @@
+/*
+ * File functions shared by the platform layers that don't need anything from SDL
+ */
+
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+#endif
+
+#include"game_platform_interface.h"
+
+void *DEBUG_platform_read_entire_file(const char *filename, s64 *returned_size)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        FATAL_PRINTF("Couldn't open \"%s\"\n", filename);
+    }
+
+    fseek(file, 0, SEEK_END);
+    s64 size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0)
+    {
+        FATAL_PRINTF("Couldn't get size of \"%s\"\n", filename);
+    }
+
+    void* buffer = malloc(size);
+    if (!buffer)
+    {
+        FATAL_PRINTF("malloc of read buffer failed\n");
+    }
+
+    if (fread(buffer, size, 1, file) != 1)
+    {
+        FATAL_PRINTF("Read less than expected from \"%s\"\n", filename);
+    }
+    fclose(file);
+
+    *returned_size = size;
+
+    return buffer;
+}
+
+char *DEBUG_platform_read_entire_file_as_string(const char *filename, s64 *returned_size)
+{
+    void* file_data = DEBUG_platform_read_entire_file(filename, returned_size);
+    char* string = (char*)malloc(*returned_size + 1);
+    if (!string)
+    {
+        FATAL_PRINTF("malloc of read string buffer failed\n");
+    }
+
+    memcpy(string, file_data, *returned_size);
+    string[*returned_size] = '\0';
+    free(file_data);
+
+    return string;
+}
+
+void DEBUG_platform_free_file_memory(void *memory)
+{
+    free(memory);
+}
+
+void *DEBUG_platform_map_file(const char *filename, s64 *returned_size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        DEBUG_PRINTF("Couldn't open \"%s\"\n", filename);
+        return NULL;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    CloseHandle(file);
+    if (!mapping)
+    {
+        DEBUG_PRINTF("Couldn't map \"%s\"\n", filename);
+        return NULL;
+    }
+    // the view keeps the mapping alive
+    void *memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!memory)
+    {
+        DEBUG_PRINTF("Couldn't map \"%s\"\n", filename);
+        return NULL;
+    }
+    *returned_size = size.QuadPart;
+    return memory;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        DEBUG_PRINTF("Couldn't open \"%s\"\n", filename);
+        return NULL;
+    }
+    struct stat st;
+    void *memory = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        memory = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // the mapping keeps the file alive
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        DEBUG_PRINTF("Couldn't map \"%s\"\n", filename);
+        return NULL;
+    }
+    *returned_size = st.st_size;
+    return memory;
+#endif
+}
+
+void DEBUG_platform_unmap_file(void *memory, s64 size)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(memory);
+#else
+    munmap(memory, size);
+#endif
+}
@@ -0,0 +1,372 @@
+/*
+ * Game memory allocation shared by the platform layers, see platform_memory.h
+ */
+
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<errno.h>
+#endif
+
+#include"platform_memory.h"
+
+// Small enough to touch every page, whatever size they are
+#define PREFAULT_STRIDE KIBIBYTES(4)
+#define HUGE_PAGE_SIZE MEBIBYTES(2)
+
+static const char* game_memory_pages_names[] = {
+    "default",
+    "huge",
+    "transparent",
+};
+
+bool platform_parse_game_memory_pages(const char* name, GameMemoryPages* pages)
+{
+    for (int i = 0; i < (int)SIZE_OF_ARRAY(game_memory_pages_names); ++i)
+    {
+        if (!strcmp(name, game_memory_pages_names[i]))
+        {
+            *pages = (GameMemoryPages)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* platform_game_memory_pages_name(GameMemoryPages pages)
+{
+    return game_memory_pages_names[pages];
+}
+
+/*
+ * Faults the pages in by writing to each, so each gets its own page rather than the shared zero page
+ */
+static void prefault_memory(void* memory, u64 size)
+{
+#ifdef MADV_POPULATE_WRITE
+    // Linux 5.14 on, does the same without a fault per page
+    if (!madvise(memory, size, MADV_POPULATE_WRITE))
+    {
+        return;
+    }
+#endif
+    volatile u8* bytes = (volatile u8*)memory;
+    for (u64 offset = 0; offset < size; offset += PREFAULT_STRIDE)
+    {
+        bytes[offset] = 0;
+    }
+}
+
+#ifdef _WIN32
+static HANDLE backing_file = INVALID_HANDLE_VALUE;    // open while file backed memory is mapped
+
+/*
+ * Maps size bytes of a file created at path if need be, at address unless it's 0
+ */
+static void* map_backing_file(const char* path, u64 size, u64 address, bool* restored)
+{
+    backing_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (backing_file == INVALID_HANDLE_VALUE)
+    {
+        DEBUG_PRINTF("Couldn't open \"%s\" to back game memory (error %lu)\n", path, GetLastError());
+        return NULL;
+    }
+    LARGE_INTEGER file_size;
+    *restored = GetFileSizeEx(backing_file, &file_size) && file_size.QuadPart > 0;
+    // extends the file with zeros if it's smaller
+    HANDLE mapping = CreateFileMappingA(backing_file, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, NULL);
+    void* memory = NULL;
+    if (mapping)
+    {
+        memory = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, (LPVOID)address);
+        // the view keeps the mapping alive
+        CloseHandle(mapping);
+    }
+    if (!memory)
+    {
+        DEBUG_PRINTF("Couldn't map \"%s\" as game memory (error %lu)\n", path, GetLastError());
+        CloseHandle(backing_file);
+        backing_file = INVALID_HANDLE_VALUE;
+    }
+    return memory;
+}
+
+/*
+ * Returns NULL without trying smaller pages if address is taken, so the caller can try the
+ * same pages elsewhere
+ */
+static void* map_game_memory(u64 size, u64 address, GameMemoryOptions* options, bool* resident)
+{
+    void* memory = NULL;
+    if (options->pages == GAME_MEMORY_PAGES_HUGE)
+    {
+        // needs the "Lock pages in memory" privilege, which accounts don't have by default
+        SIZE_T large_page_size = GetLargePageMinimum();
+        if (large_page_size && size % large_page_size == 0)
+        {
+            memory = VirtualAlloc((LPVOID)address, size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (!memory && address && GetLastError() == ERROR_INVALID_ADDRESS)
+            {
+                return NULL;
+            }
+        }
+        if (!memory)
+        {
+            DEBUG_PRINTF("Large pages aren't available (error %lu), using default pages\n", GetLastError());
+        }
+        // large pages can't be paged out, so they're all there already
+        *resident = memory != NULL;
+    }
+    else if (options->pages == GAME_MEMORY_PAGES_TRANSPARENT)
+    {
+        DEBUG_PRINTF("Transparent huge pages are Linux only, using default pages\n");
+    }
+    if (!memory)
+    {
+        options->pages = GAME_MEMORY_PAGES_DEFAULT;
+        memory = VirtualAlloc((LPVOID)address, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    }
+    return memory;
+}
+
+#else   // _WIN32
+
+static bool file_backed = false;
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+/*
+ * Maps size bytes, of the file if fd isn't -1. At address unless it's 0, failing with EEXIST
+ * rather than replacing anything mapped there
+ */
+static void* map_memory(u64 size, u64 address, int flags, int fd)
+{
+    flags |= fd == -1 ? MAP_ANONYMOUS | MAP_PRIVATE : MAP_SHARED;
+    if (address)
+    {
+        flags |= MAP_FIXED_NOREPLACE;
+    }
+    void* memory = mmap((void*)address, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (memory == MAP_FAILED)
+    {
+        return NULL;
+    }
+    if (address && memory != (void*)address)
+    {
+        // kernels before 4.17 take MAP_FIXED_NOREPLACE as just a hint
+        munmap(memory, size);
+        errno = EEXIST;
+        return NULL;
+    }
+    return memory;
+}
+
+/*
+ * Maps size bytes starting on a huge page boundary, since transparent huge pages only back
+ * aligned 2 MiB ranges
+ */
+static void* map_huge_page_aligned(u64 size, u64 address)
+{
+    if (address)
+    {
+        DEBUG_ASSERT(address % HUGE_PAGE_SIZE == 0);
+        return map_memory(size, address, 0, -1);
+    }
+    u8* memory = (u8*)map_memory(size + HUGE_PAGE_SIZE, 0, 0, -1);
+    if (!memory)
+    {
+        return NULL;
+    }
+    u8* aligned = (u8*)(((uintptr_t)memory + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+    // give back the ends
+    if (aligned > memory)
+    {
+        munmap(memory, aligned - memory);
+    }
+    u64 tail = (memory + size + HUGE_PAGE_SIZE) - (aligned + size);
+    if (tail)
+    {
+        munmap(aligned + size, tail);
+    }
+    return aligned;
+}
+
+/*
+ * Maps size bytes of a file created at path if need be, at address unless it's 0
+ */
+static void* map_backing_file(const char* path, u64 size, u64 address, bool prefault, bool* restored)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd == -1)
+    {
+        DEBUG_PRINTF("Couldn't open \"%s\" to back game memory (%s)\n", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    *restored = !fstat(fd, &st) && st.st_size > 0;
+    // sized to fit, new space is zeros that aren't written out until they're touched
+    void* memory = NULL;
+    if (!ftruncate(fd, size))
+    {
+        memory = map_memory(size, address, prefault ? MAP_POPULATE : 0, fd);
+    }
+    if (!memory)
+    {
+        DEBUG_PRINTF("Couldn't map \"%s\" as game memory (%s)\n", path, strerror(errno));
+    }
+    // the mapping keeps the file open
+    close(fd);
+    return memory;
+}
+
+/*
+ * Returns NULL without trying smaller pages if address is taken, so the caller can try the
+ * same pages elsewhere
+ */
+static void* map_game_memory(u64 size, u64 address, GameMemoryOptions* options, bool* resident)
+{
+    void* memory = NULL;
+    int populate = options->prefault ? MAP_POPULATE : 0;
+    if (options->pages == GAME_MEMORY_PAGES_HUGE)
+    {
+        DEBUG_ASSERT(size % HUGE_PAGE_SIZE == 0);
+        // private huge page mappings take their pages from the pool now, so this fails here
+        // rather than with a SIGBUS on some later first touch
+        memory = map_memory(size, address, MAP_HUGETLB | populate, -1);
+        if (!memory && errno == EEXIST)
+        {
+            return NULL;
+        }
+        if (!memory)
+        {
+            if (errno == ENOMEM || errno == EINVAL)
+            {
+                DEBUG_PRINTF("MAP_HUGETLB failed (%s), are any huge pages reserved in /proc/sys/vm/nr_hugepages? Trying transparent huge pages\n", strerror(errno));
+            }
+            else
+            {
+                DEBUG_PRINTF("MAP_HUGETLB failed (%s), trying transparent huge pages\n", strerror(errno));
+            }
+            options->pages = GAME_MEMORY_PAGES_TRANSPARENT;
+        }
+        *resident = memory && populate;
+    }
+    if (!memory && options->pages == GAME_MEMORY_PAGES_TRANSPARENT)
+    {
+        memory = map_huge_page_aligned(size, address);
+        if (!memory && errno == EEXIST)
+        {
+            return NULL;
+        }
+        // has to be advised before the pages are faulted in, so no MAP_POPULATE
+        if (memory && madvise(memory, size, MADV_HUGEPAGE))
+        {
+            DEBUG_PRINTF("MADV_HUGEPAGE failed (%s), using default pages\n", strerror(errno));
+            options->pages = GAME_MEMORY_PAGES_DEFAULT;
+        }
+    }
+    if (!memory)
+    {
+        options->pages = GAME_MEMORY_PAGES_DEFAULT;
+        memory = map_memory(size, address, populate, -1);
+        *resident = memory && populate;
+    }
+    return memory;
+}
+#endif  // else _WIN32
+
+void* platform_alloc_game_memory(u64 size, GameMemoryOptions* options)
+{
+    void* memory = NULL;
+    bool resident = false;  // already faulted in
+    options->restored = false;
+    if (options->backing_path)
+    {
+        if (options->pages != GAME_MEMORY_PAGES_DEFAULT)
+        {
+            DEBUG_PRINTF("Huge pages can't back a file, using default pages\n");
+            options->pages = GAME_MEMORY_PAGES_DEFAULT;
+        }
+        if (!options->address)
+        {
+            DEBUG_PRINTF("Game memory backed by a file isn't at a fixed address, so it can't be resumed from\n");
+        }
+#ifdef _WIN32
+        memory = map_backing_file(options->backing_path, size, options->address, &options->restored);
+#else
+        memory = map_backing_file(options->backing_path, size, options->address, options->prefault, &options->restored);
+        file_backed = memory != NULL;
+        resident = file_backed && options->prefault;
+#endif
+        if (!memory)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        memory = map_game_memory(size, options->address, options, &resident);
+        if (!memory && options->address)
+        {
+            // same pages as were asked for, just somewhere else
+            DEBUG_PRINTF("Couldn't put game memory at 0x%llx, putting it anywhere\n", (unsigned long long)options->address);
+            options->address = 0;
+            memory = map_game_memory(size, 0, options, &resident);
+        }
+        if (!memory)
+        {
+            return NULL;
+        }
+    }
+    if (options->prefault && !resident)
+    {
+        prefault_memory(memory, size);
+    }
+    DEBUG_PRINTF("Game memory: %llu MiB at %p, %s pages%s%s%s\n",
+                 (unsigned long long)(size / MEBIBYTES(1)),
+                 memory,
+                 platform_game_memory_pages_name(options->pages),
+                 options->prefault ? ", prefaulted" : "",
+                 options->backing_path ? ", backed by " : "",
+                 options->backing_path ? options->backing_path : "");
+    return memory;
+}
+
+void platform_sync_game_memory(void* memory, u64 size)
+{
+#ifdef _WIN32
+    if (backing_file != INVALID_HANDLE_VALUE)
+    {
+        FlushViewOfFile(memory, 0);
+        FlushFileBuffers(backing_file);
+    }
+#else
+    if (file_backed && msync(memory, size, MS_SYNC))
+    {
+        DEBUG_PRINTF("Couldn't write game memory back to its file (%s)\n", strerror(errno));
+    }
+#endif
+}
+
+void platform_free_game_memory(void* memory, u64 size)
+{
+#ifdef _WIN32
+    if (backing_file != INVALID_HANDLE_VALUE)
+    {
+        UnmapViewOfFile(memory);
+        CloseHandle(backing_file);
+        backing_file = INVALID_HANDLE_VALUE;
+        return;
+    }
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, size);
+    file_backed = false;
+#endif
+}
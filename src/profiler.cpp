@@ -0,0 +1,167 @@
+#ifdef PROFILER
+
+#include<chrono>
+
+#include"profiler.h"
+#include"trace.h"
+#include"rendering.h"
+
+Profiler profiler;
+thread_local ProfileScope *ProfileScope::current = NULL;
+
+static const Color phase_colors[PROFILE_NUM_PHASES] = {
+    Color{0.9F, 0.6F, 0.1F, 1.0F},  // forces
+    Color{0.9F, 0.9F, 0.2F, 1.0F},  // aabb
+    Color{0.2F, 0.8F, 0.2F, 1.0F},  // broad
+    Color{0.2F, 0.7F, 0.9F, 1.0F},  // narrow
+    Color{0.3F, 0.3F, 1.0F, 1.0F},  // toi
+    Color{0.8F, 0.3F, 0.9F, 1.0F},  // solve
+    Color{1.0F, 1.0F, 1.0F, 1.0F},  // render
+};
+static const Color frame_color = Color{0.15F, 0.15F, 0.15F, 1.0F};
+static const Color budget_color = Color{1.0F, 0.0F, 0.0F, 1.0F};
+
+/* Graph area, in viewport coords */
+#define GRAPH_LEFT -0.95F
+#define GRAPH_BOTTOM -0.95F
+#define GRAPH_WIDTH 1.9F
+#define GRAPH_HEIGHT 0.5F
+
+/* Timestamp counter frequency is measured against the OS clock over the first frames */
+#define CALIBRATION_NS 250000000LL
+/* Blocking calibration is shorter, it's done while the game waits */
+#define CALIBRATION_SPIN_NS 20000000LL
+static u64 calibration_start_ticks;
+static s64 calibration_start_ns;
+
+static s64 clock_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void profiler_begin_frame()
+{
+    u64 now = profiler_ticks();
+    if (!calibration_start_ticks)
+    {
+        calibration_start_ticks = now;
+        calibration_start_ns = clock_ns();
+    }
+    else if (profiler.ticks_per_second == 0.0)
+    {
+        s64 elapsed_ns = clock_ns() - calibration_start_ns;
+        if (elapsed_ns >= CALIBRATION_NS)
+        {
+            profiler.ticks_per_second = (f64)(now - calibration_start_ticks) * 1e9 / (f64)elapsed_ns;
+        }
+    }
+
+    ProfileFrame *prev = &profiler.frames[profiler.curr];
+    if (prev->start)
+    {
+        prev->ticks = now - prev->start;
+        if (profiler.tracing)
+        {
+            trace_frame(prev->start, prev->ticks);
+        }
+    }
+
+    profiler.curr = (profiler.curr + 1) % PROFILER_NUM_FRAMES;
+    ProfileFrame *frame = &profiler.frames[profiler.curr];
+    frame->ticks = 0;
+    for (u32 i = 0; i < PROFILE_NUM_PHASES; ++i)
+    {
+        frame->phase_ticks[i] = 0;
+    }
+    frame->start = now;
+}
+
+void profiler_calibrate()
+{
+    if (profiler.ticks_per_second != 0.0)
+        return;
+
+    u64 start_ticks = profiler_ticks();
+    s64 start_ns = clock_ns();
+    s64 elapsed_ns;
+    do
+    {
+        elapsed_ns = clock_ns() - start_ns;
+    } while (elapsed_ns < CALIBRATION_SPIN_NS);
+    profiler.ticks_per_second = (f64)(profiler_ticks() - start_ticks) * 1e9 / (f64)elapsed_ns;
+}
+
+void profiler_toggle_overlay()
+{
+    profiler.show_overlay = !profiler.show_overlay;
+}
+
+void profiler_draw_overlay(f32 frame_budget_s)
+{
+    if (!profiler.show_overlay || profiler.ticks_per_second == 0.0)
+        return;
+
+    /* fixed to the screen, wherever the game's camera is */
+    rendering_set_camera(Vec2(0.0F, 0.0F), 1.0F);
+
+    /* budget is at half height, so there's room to see how far over a slow frame is */
+    f32 height_per_tick = (f32)(GRAPH_HEIGHT / 2.0 / (frame_budget_s * profiler.ticks_per_second));
+    f32 bar_width = GRAPH_WIDTH / (f32)(PROFILER_NUM_FRAMES - 1);
+
+    /* oldest completed frame on the left, up to the last completed frame */
+    for (u32 i = 0; i < PROFILER_NUM_FRAMES - 1; ++i)
+    {
+        ProfileFrame *frame = &profiler.frames[(profiler.curr + 1 + i) % PROFILER_NUM_FRAMES];
+        if (!frame->ticks)
+            continue;
+
+        f32 x = GRAPH_LEFT + ((f32)i + 0.5F) * bar_width;
+        f32 frame_height = MIN((f32)frame->ticks * height_per_tick, GRAPH_HEIGHT);
+        rendering_draw_rect(
+            Vec2(x, GRAPH_BOTTOM + frame_height / 2.0F),
+            0,
+            Vec2(bar_width, frame_height),
+            NULL,
+            frame_color,
+            false);
+
+        f32 y = GRAPH_BOTTOM;
+        for (u32 p = 0; p < PROFILE_NUM_PHASES && y < GRAPH_BOTTOM + GRAPH_HEIGHT; ++p)
+        {
+            f32 phase_height = (f32)frame->phase_ticks[p] * height_per_tick;
+            phase_height = MIN(phase_height, GRAPH_BOTTOM + GRAPH_HEIGHT - y);
+            /* skip anything under a pixel-ish */
+            if (phase_height < 0.002F)
+                continue;
+            rendering_draw_rect(
+                Vec2(x, y + phase_height / 2.0F),
+                0,
+                Vec2(bar_width, phase_height),
+                NULL,
+                phase_colors[p],
+                false);
+            y += phase_height;
+        }
+    }
+
+    rendering_draw_line(
+        Vec2(GRAPH_LEFT, GRAPH_BOTTOM + GRAPH_HEIGHT / 2.0F),
+        Vec2(GRAPH_WIDTH, 0.0F),
+        1,
+        budget_color);
+
+    /* legend, in phase order bottom to top */
+    for (u32 p = 0; p < PROFILE_NUM_PHASES; ++p)
+    {
+        rendering_draw_rect(
+            Vec2(GRAPH_LEFT + 0.02F + (f32)p * 0.05F, GRAPH_BOTTOM + GRAPH_HEIGHT + 0.03F),
+            0,
+            Vec2(0.04F, 0.02F),
+            NULL,
+            phase_colors[p],
+            false);
+    }
+}
+
+#endif // PROFILER
@@ -0,0 +1,62 @@
+#include"scene_file.h"
+
+static_assert(sizeof(Obj) == 92, "Obj layout changed - bump SCENE_FILE_VERSION and update this");
+static_assert(sizeof(SceneFileHeader) <= SCENE_FILE_OBJS_OFFSET, "Scene file header overlaps bodies");
+
+Obj *scene_file_objs(void *data, s64 size, u32 *num_objs)
+{
+    SceneFileHeader *header = (SceneFileHeader *)data;
+    if (size < (s64)sizeof(SceneFileHeader) || header->magic != SCENE_FILE_MAGIC)
+    {
+        DEBUG_PRINTF("Not a scene file\n");
+        return NULL;
+    }
+    if (header->version != SCENE_FILE_VERSION || header->obj_size != sizeof(Obj))
+    {
+        DEBUG_PRINTF("Unsupported scene file version %u (expected %u)\n", header->version, SCENE_FILE_VERSION);
+        return NULL;
+    }
+    if (header->objs_offset % alignof(Obj) != 0
+        || header->objs_offset > (u64)size
+        || (u64)header->num_objs * sizeof(Obj) > (u64)size - header->objs_offset)
+    {
+        DEBUG_PRINTF("Scene file is truncated or corrupt\n");
+        return NULL;
+    }
+
+    *num_objs = header->num_objs;
+    return (Obj *)((u8 *)data + header->objs_offset);
+}
+
+bool scene_file_write(const char *filename, Obj *objs, u32 num_objs)
+{
+    FILE *file = fopen(filename, "wb");
+    if (!file)
+    {
+        DEBUG_PRINTF("Couldn't open \"%s\" for writing\n", filename);
+        return false;
+    }
+
+    u8 header_buf[SCENE_FILE_OBJS_OFFSET] = {};
+    SceneFileHeader *header = (SceneFileHeader *)header_buf;
+    header->magic = SCENE_FILE_MAGIC;
+    header->version = SCENE_FILE_VERSION;
+    header->obj_size = sizeof(Obj);
+    header->num_objs = num_objs;
+    header->objs_offset = SCENE_FILE_OBJS_OFFSET;
+
+    bool ok = fwrite(header_buf, sizeof(header_buf), 1, file) == 1;
+    if (ok && num_objs)
+    {
+        ok = fwrite(objs, sizeof(Obj), num_objs, file) == num_objs;
+    }
+    if (fclose(file) != 0)
+    {
+        ok = false;
+    }
+    if (!ok)
+    {
+        DEBUG_PRINTF("Failed writing scene file \"%s\"\n", filename);
+    }
+    return ok;
+}
@@ -0,0 +1,179 @@
+#include"scene_gen.h"
+
+/* Gives a 0.2 radius circle a mass of 1, like the hand made scenes */
+#define DENSITY (1.0F / (M_PI * 0.2F * 0.2F))
+/* Space between the packed region, terrain and walls */
+#define GAP 0.01F
+#define WALL_THICKNESS 0.1F
+
+SceneGenParams scene_gen_preset(SceneGenPreset preset, u32 seed)
+{
+    SceneGenParams params = {};
+    params.seed = seed;
+    params.region_min = Vec2(-0.95F, -0.95F);
+    params.region_max = Vec2(0.95F, 0.95F);
+    params.size_skew = 1.0F;
+    params.flow_frequency = 2.0F;
+    params.terrain_frequency = 4.0F;
+    params.walls = true;
+
+    switch (preset)
+    {
+        case SCENE_GEN_PACKED_CIRCLES:
+            params.num_bodies = 4000;
+            params.min_size = 0.008F;
+            params.max_size = 0.012F;
+            params.max_speed = 0.2F;
+            break;
+        case SCENE_GEN_MIXED_TERRAIN:
+            params.num_bodies = 1500;
+            params.region_min = Vec2(-0.95F, -0.6F);
+            params.rect_fraction = 0.4F;
+            params.static_fraction = 0.15F;
+            params.min_size = 0.01F;
+            params.max_size = 0.04F;
+            params.size_skew = 2.5F;
+            params.max_speed = 0.3F;
+            params.max_angular_speed = 2.0F;
+            params.terrain_segments = 64;
+            params.terrain_height = 0.25F;
+            break;
+        case SCENE_GEN_FLOW_FIELD:
+        default:
+            params.num_bodies = 2500;
+            params.rect_fraction = 0.3F;
+            params.min_size = 0.01F;
+            params.max_size = 0.02F;
+            params.max_speed = 1.0F;
+            params.max_angular_speed = 5.0F;
+            params.flow_frequency = 3.0F;
+            break;
+    }
+    return params;
+}
+
+bool scene_gen_generate(GameState *game_state, SceneGenParams *params)
+{
+    u32 num_objs = params->num_bodies + params->terrain_segments + (params->walls ? 4 : 0);
+    if (num_objs > MAX_OBJS)
+    {
+        DEBUG_PRINTF("Generated scene has %u bodies, max is %u\n", num_objs, MAX_OBJS);
+        return false;
+    }
+    Vec2 region_size = params->region_max - params->region_min;
+    if (region_size.x <= 0.0F || region_size.y <= 0.0F)
+    {
+        DEBUG_PRINTF("Generated scene region is empty\n");
+        return false;
+    }
+
+    clear_game_state(game_state);
+
+    RandomGenerator rng(params->seed);
+    PerlinNoiseGenerator noise(params->seed);
+
+    /* Grid with roughly square cells, and at least num_bodies of them */
+    u32 cols = 1;
+    u32 rows = 1;
+    if (params->num_bodies)
+    {
+        cols = (u32)ceilf(sqrtf((f32)params->num_bodies * region_size.x / region_size.y));
+        cols = MAX(cols, 1U);
+        rows = (params->num_bodies + cols - 1) / cols;
+    }
+    Vec2 cell_size = Vec2(region_size.x / (f32)cols, region_size.y / (f32)rows);
+    /* Largest bounding radius that fits in a cell, leaving a gap */
+    f32 max_radius = MIN(cell_size.x, cell_size.y) * 0.45F;
+    f32 max_size = MIN(params->max_size, max_radius);
+    f32 min_size = MIN(params->min_size, max_size);
+
+    for (u32 i = 0; i < params->num_bodies; ++i)
+    {
+        u32 col = i % cols;
+        u32 row = i / cols;
+        Vec2 cell_centre = params->region_min + Vec2(((f32)col + 0.5F) * cell_size.x, ((f32)row + 0.5F) * cell_size.y);
+
+        f32 size = min_size + (max_size - min_size) * powf(rng.next_f32(), params->size_skew);
+        bool is_rect = rng.next_f32() < params->rect_fraction;
+        bool is_static = rng.next_f32() < params->static_fraction;
+        f32 aspect = rng.range(0.3F, 1.0F);
+        f32 rot = rng.range(0.0F, 2.0F * M_PI);
+
+        f32 radius = size;
+        if (is_rect)
+        {
+            /* rect can be at any rotation, so fit its diagonal */
+            radius = size * sqrtf(1.0F + aspect * aspect);
+            if (radius > max_radius)
+            {
+                size *= max_radius / radius;
+                radius = max_radius;
+            }
+        }
+        Vec2 jitter = Vec2(
+            rng.range(-1.0F, 1.0F) * (cell_size.x / 2.0F - radius),
+            rng.range(-1.0F, 1.0F) * (cell_size.y / 2.0F - radius));
+        Vec2 pos = cell_centre + jitter;
+
+        Obj obj;
+        if (is_rect)
+        {
+            f32 width = size * 2.0F;
+            f32 height = size * 2.0F * aspect;
+            if (is_static)
+                obj = Obj::static_rect(width, height, pos, rot);
+            else
+                obj = Obj::dyn_rect(width, height, pos, rot, width * height * DENSITY);
+        }
+        else
+        {
+            if (is_static)
+                obj = Obj::static_circle(size, pos);
+            else
+                obj = Obj::dyn_circle(size, pos, M_PI * size * size * DENSITY);
+        }
+
+        if (!is_static)
+        {
+            /* noise is mirrored around 0, so keep coords positive */
+            Vec2 flow_pos = (pos - params->region_min) * params->flow_frequency + Vec2(1.0F, 1.0F);
+            f32 angle = noise.noise(flow_pos.x, flow_pos.y, 0.5F) * 4.0F * M_PI;
+            f32 speed = noise.noise(flow_pos.x, flow_pos.y, 10.5F) * params->max_speed;
+            obj.vel = Vec2(cosf(angle), sinf(angle)) * speed;
+            obj.alpha = (noise.noise(flow_pos.x, flow_pos.y, 20.5F) * 2.0F - 1.0F) * params->max_angular_speed;
+        }
+        game_state->add_obj(obj);
+    }
+
+    Vec2 bounds_min = params->region_min - Vec2(GAP, GAP);
+    Vec2 bounds_max = params->region_max + Vec2(GAP, GAP);
+
+    if (params->terrain_segments)
+    {
+        f32 segment_width = region_size.x / (f32)params->terrain_segments;
+        f32 top = params->region_min.y - GAP;
+        for (u32 i = 0; i < params->terrain_segments; ++i)
+        {
+            f32 x = params->region_min.x + ((f32)i + 0.5F) * segment_width;
+            f32 n = noise.octave_noise((f32)i * segment_width * params->terrain_frequency + 1.0F, 1.5F, 0.5F, 4, 0.5F);
+            f32 height = params->terrain_height * (0.25F + n);
+            game_state->add_obj(Obj::static_rect(segment_width, height, Vec2(x, top - height / 2.0F), 0));
+        }
+        /* noise is in 0..1, so this is as low as the terrain goes */
+        bounds_min.y = top - params->terrain_height * 1.25F - GAP;
+    }
+
+    if (params->walls)
+    {
+        Vec2 size = bounds_max - bounds_min;
+        Vec2 centre = (bounds_min + bounds_max) / 2.0F;
+        f32 t = WALL_THICKNESS;
+        game_state->add_obj(Obj::static_rect(size.x + 2.0F * t, t, Vec2(centre.x, bounds_max.y + t / 2.0F), 0));
+        game_state->add_obj(Obj::static_rect(size.x + 2.0F * t, t, Vec2(centre.x, bounds_min.y - t / 2.0F), 0));
+        game_state->add_obj(Obj::static_rect(t, size.y, Vec2(bounds_max.x + t / 2.0F, centre.y), 0));
+        game_state->add_obj(Obj::static_rect(t, size.y, Vec2(bounds_min.x - t / 2.0F, centre.y), 0));
+    }
+
+    DEBUG_PRINTF("Generated scene with %u bodies (seed %u)\n", game_state->num_objs, params->seed);
+    return true;
+}
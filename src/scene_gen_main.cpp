@@ -0,0 +1,117 @@
+/*
+ * Command line tool that writes generated stress scenes to scene files, for use with --scene
+ */
+#include"scene_gen.h"
+#include"scene_file.h"
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr,
+        "usage: %s [options] <output file>\n"
+        "  --preset <n>             start from preset n (0 packed circles, 1 mixed with terrain, 2 flow field), default 0\n"
+        "  --seed <n>               default 1\n"
+        "  --bodies <n>             number of packed bodies\n"
+        "  --region <x0 y0 x1 y1>   area the bodies are packed into\n"
+        "  --rects <0..1>           fraction of bodies that are rects\n"
+        "  --static <0..1>          fraction of bodies that are static\n"
+        "  --size <min max>         radius, or half the longest side of a rect\n"
+        "  --skew <f>               size distribution; > 1 favours small bodies\n"
+        "  --speed <f>              max initial speed\n"
+        "  --spin <f>               max initial angular speed\n"
+        "  --flow <f>               flow field frequency\n"
+        "  --terrain <n>            number of terrain segments, 0 for none\n"
+        "  --terrain-height <f>\n"
+        "  --terrain-frequency <f>\n"
+        "  --no-walls\n",
+        name);
+}
+
+int main(int argc, char* args[])
+{
+    /* First pass for the preset and seed, which the other options modify */
+    u32 preset = 0;
+    u32 seed = 1;
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (!strcmp(args[i], "--preset"))
+            preset = (u32)strtoul(args[i + 1], NULL, 0);
+        else if (!strcmp(args[i], "--seed"))
+            seed = (u32)strtoul(args[i + 1], NULL, 0);
+    }
+    if (preset >= SCENE_GEN_NUM_PRESETS)
+    {
+        print_usage(args[0]);
+        return 1;
+    }
+    SceneGenParams params = scene_gen_preset((SceneGenPreset)preset, seed);
+
+    const char *out_path = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        int remaining = argc - i - 1;
+        if ((!strcmp(args[i], "--preset") || !strcmp(args[i], "--seed")) && remaining >= 1)
+            i += 1;
+        else if (!strcmp(args[i], "--bodies") && remaining >= 1)
+            params.num_bodies = (u32)strtoul(args[++i], NULL, 0);
+        else if (!strcmp(args[i], "--region") && remaining >= 4)
+        {
+            params.region_min = Vec2((f32)atof(args[i + 1]), (f32)atof(args[i + 2]));
+            params.region_max = Vec2((f32)atof(args[i + 3]), (f32)atof(args[i + 4]));
+            i += 4;
+        }
+        else if (!strcmp(args[i], "--rects") && remaining >= 1)
+            params.rect_fraction = (f32)atof(args[++i]);
+        else if (!strcmp(args[i], "--static") && remaining >= 1)
+            params.static_fraction = (f32)atof(args[++i]);
+        else if (!strcmp(args[i], "--size") && remaining >= 2)
+        {
+            params.min_size = (f32)atof(args[i + 1]);
+            params.max_size = (f32)atof(args[i + 2]);
+            i += 2;
+        }
+        else if (!strcmp(args[i], "--skew") && remaining >= 1)
+            params.size_skew = (f32)atof(args[++i]);
+        else if (!strcmp(args[i], "--speed") && remaining >= 1)
+            params.max_speed = (f32)atof(args[++i]);
+        else if (!strcmp(args[i], "--spin") && remaining >= 1)
+            params.max_angular_speed = (f32)atof(args[++i]);
+        else if (!strcmp(args[i], "--flow") && remaining >= 1)
+            params.flow_frequency = (f32)atof(args[++i]);
+        else if (!strcmp(args[i], "--terrain") && remaining >= 1)
+            params.terrain_segments = (u32)strtoul(args[++i], NULL, 0);
+        else if (!strcmp(args[i], "--terrain-height") && remaining >= 1)
+            params.terrain_height = (f32)atof(args[++i]);
+        else if (!strcmp(args[i], "--terrain-frequency") && remaining >= 1)
+            params.terrain_frequency = (f32)atof(args[++i]);
+        else if (!strcmp(args[i], "--no-walls"))
+            params.walls = false;
+        else if (!out_path && args[i][0] != '-')
+            out_path = args[i];
+        else
+        {
+            print_usage(args[0]);
+            return 1;
+        }
+    }
+    if (!out_path)
+    {
+        print_usage(args[0]);
+        return 1;
+    }
+
+    GameState *game_state = (GameState *)calloc(1, sizeof(GameState));
+    if (!game_state || !scene_gen_generate(game_state, &params))
+    {
+        fprintf(stderr, "Couldn't generate scene\n");
+        return 1;
+    }
+    if (!scene_file_write(out_path, game_state->objs, game_state->num_objs))
+    {
+        fprintf(stderr, "Couldn't write \"%s\"\n", out_path);
+        return 1;
+    }
+    printf("wrote %u bodies to %s\n", game_state->num_objs, out_path);
+    free(game_state);
+
+    return 0;
+}
@@ -11,30 +11,36 @@
 #include<SDL.h>
 #include<limits.h>
 
-#define LARGE_ALLOC(SZ) VirtualAlloc(NULL, (SZ), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)
-#define LARGE_ALLOC_FIXED(SZ, ADDR) VirtualAlloc((LPVOID)(ADDR), (SZ), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)
-#define LARGE_FREE(PTR,SZ) DEBUG_ASSERT(VirtualFree((PTR), 0, MEM_RELEASE))
-
 static const int MAX_PATH_LENGTH = MAX_PATH;
 
 #else   // _WIN32
 
 #ifdef __linux__
-#include<sys/mman.h>
 #include<SDL2/SDL.h>
 #include<limits.h>
 
-#define LARGE_ALLOC(X) mmap(NULL, (X), PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0)
-// TODO fixed alloc on linux
-#define LARGE_ALLOC_FIXED(SZ, ADDR) LARGE_ALLOC(SZ)
-#define LARGE_FREE(X,Y) munmap((X), (Y))
-
 static const int MAX_PATH_LENGTH = PATH_MAX;
 
 #endif // __linux__
 #endif // else _WIN32
 
+#include<atomic>
+
 #include"game_platform_interface.h"
+#include"input_recording.h"
+#include"histogram.h"
+#include"frame_pacer.h"
+#include"frame_capture.h"
+#include"platform_memory.h"
+#include"rendering.h"
+#include"trace.h"
+#if defined(RENDERER_SOFTWARE)
+#include"sw_rendering.h"
+#elif defined(RENDERER_NULL)
+#include"null_rendering.h"
+#else
+#define RENDERER_GL
+#endif
 
 #define EXP_WEIGHTED_AVG(avg, N, new_sample) (((float)(avg) - (float)(avg)/(float)(N)) + (float)(new_sample)/(float)(N))
 
@@ -56,8 +62,16 @@ static char* executable_path;                       // allocated by SDL
 
 // Rendering
 static SDL_Window* window = NULL;
-static SDL_GLContext gl_context = NULL;
+#ifdef RENDERER_SOFTWARE
+// The software renderer's frames are copied to this texture to be shown
+static SDL_Renderer* renderer = NULL;
 static SDL_Texture* texture = NULL;
+static int texture_width = 0;
+static int texture_height = 0;
+#endif
+#ifdef RENDERER_GL
+static SDL_GLContext gl_context = NULL;
+#endif
 static const int BYTES_PER_PIXEL = 4;
 // TODO dynamic or adjustable
 static int target_framerate = 60;
@@ -69,76 +83,65 @@ static GameMemory game_memory{};
 static GameInputBuffer game_input_buffer{};
 static GameRenderInfo game_render_info;
 
-/*
-void set_game_resolution(int resolution_multiple_index)
+// Frame pacing, see frame_pacer.h
+static FramePacing frame_pacing = FRAME_PACING_SLEEP;
+static FramePacer frame_pacer;
+
+// Input recording and playback
+static InputRecording input_recording{};
+static InputPlayback input_playback{};
+
+// Frame capture, see frame_capture.h
+static FrameCapture frame_capture{};
+static bool capturing = false;
+
+// Simulation thread, when live. Replays simulate on the main thread, one update per recorded frame
+static SDL_Thread* sim_thread = NULL;
+static SDL_mutex* sim_input_mutex = NULL;
+static GameInput sim_input;             // latest input from the main thread, guarded by sim_input_mutex
+static std::atomic<bool> sim_running;
+static SDL_mutex* sim_histogram_mutex = NULL;   // guards sim_histogram while the simulation thread runs
+
+// Frame timing, reported on exit and with F3
+static Histogram frame_histogram;       // start of one frame to the start of the next
+static Histogram sim_histogram;         // game update, written by the simulation thread when live
+static Histogram render_histogram;      // game render and buffer swap
+static Histogram overshoot_histogram;   // how far past the deadline the frame pacer woke up
+// smoothed frame time for the window title
+static const int FRAME_AVG_SAMPLES = 30;
+static float avg_frame_ms = 0.0F;
+
+static uint64_t perf_counter_to_ns(uint64_t count)
 {
-    game_render_info.resolution_multiple_index = resolution_multiple_index;
-    SDL_SetWindowSize(window,
-        GAME_ASPECT_RATIO_WIDTH * game_render_info.get_resolution_multiple() * GAME_RESOLUTION_BASE_FACTOR,
-        GAME_ASPECT_RATIO_HEIGHT * game_render_info.get_resolution_multiple() * GAME_RESOLUTION_BASE_FACTOR);
+    return (uint64_t)((double)count * 1e9 / (double)SDL_GetPerformanceFrequency());
 }
-*/
 
-void *DEBUG_platform_read_entire_file(const char *filename, s64 *returned_size)
+static void print_frame_timings()
 {
-    SDL_RWops* file = SDL_RWFromFile(filename, "rb");
-    if (!file)
+    printf("frame timings:\n");
+    histogram_print(&frame_histogram, stdout);
+    if (sim_histogram_mutex)
     {
-        FATAL_PRINTF("SDL Error: %s\n", SDL_GetError());
+        SDL_LockMutex(sim_histogram_mutex);
     }
-
-    int64_t size = SDL_RWsize(file);
-    if (size < 0)
+    histogram_print(&sim_histogram, stdout);
+    if (sim_histogram_mutex)
     {
-        FATAL_PRINTF("SDL Error: %s\n", SDL_GetError());
+        SDL_UnlockMutex(sim_histogram_mutex);
     }
-
-    void* buffer = malloc(size);
-    if (!buffer)
-    {
-        FATAL_PRINTF("malloc of read buffer failed\n");
-    }
-
-    int64_t len = SDL_RWread(file, buffer, size, 1);
-    if (len <= 0)
-    {
-        FATAL_PRINTF("%s\n", SDL_GetError());
-    }
-    if (len != 1)
-    {
-        FATAL_PRINTF("Read less than expected: read %I64d, expected 1\n", len);
-    }
-
-    if (SDL_RWclose(file))
-    {
-        FATAL_PRINTF("SDL Error: %s\n", SDL_GetError());
-    }
-
-    *returned_size = size;
-
-    return buffer;
-}
-
-char *DEBUG_platform_read_entire_file_as_string(const char *filename, s64 *returned_size)
-{
-    void* file_data = DEBUG_platform_read_entire_file(filename, returned_size);
-    char* string = (char*)malloc(*returned_size + 1);
-    if (!string)
-    {
-        FATAL_PRINTF("malloc of read string buffer failed\n");
-    }
-
-    SDL_memcpy(string, file_data, *returned_size);
-    string[*returned_size] = '\0';
-    free(file_data);
-
-    return string;
+    histogram_print(&render_histogram, stdout);
+    histogram_print(&overshoot_histogram, stdout);
 }
 
-void DEBUG_platform_free_file_memory(void *memory)
+/*
+void set_game_resolution(int resolution_multiple_index)
 {
-    free(memory);
+    game_render_info.resolution_multiple_index = resolution_multiple_index;
+    SDL_SetWindowSize(window,
+        GAME_ASPECT_RATIO_WIDTH * game_render_info.get_resolution_multiple() * GAME_RESOLUTION_BASE_FACTOR,
+        GAME_ASPECT_RATIO_HEIGHT * game_render_info.get_resolution_multiple() * GAME_RESOLUTION_BASE_FACTOR);
 }
+*/
 
 static void handle_event(SDL_Event* e)
 {
@@ -176,9 +179,18 @@ static void handle_event(SDL_Event* e)
                 case SDL_BUTTON_RIGHT:
                     input->mouse_right_down = key_state;
                     break;
+                case SDL_BUTTON_MIDDLE:
+                    input->mouse_middle_down = key_state;
+                    break;
             }
             break;
         }
+        case SDL_MOUSEWHEEL:
+        {
+            GameInput* input = &(game_input_buffer.buffer[game_input_buffer.last]);
+            input->mouse_wheel_scrolled += e->wheel.direction == SDL_MOUSEWHEEL_FLIPPED ? -e->wheel.y : e->wheel.y;
+            break;
+        }
         case SDL_KEYDOWN:
             key_state = true;
         case SDL_KEYUP:
@@ -219,12 +231,45 @@ static void handle_event(SDL_Event* e)
                 case SDLK_3:
                     input->_3 = key_state;
                     break;
+                case SDLK_4:
+                    input->_4 = key_state;
+                    break;
+                case SDLK_5:
+                    input->_5 = key_state;
+                    break;
+                case SDLK_6:
+                    input->_6 = key_state;
+                    break;
+                case SDLK_7:
+                    input->_7 = key_state;
+                    break;
+                case SDLK_8:
+                    input->_8 = key_state;
+                    break;
+                case SDLK_9:
+                    input->_9 = key_state;
+                    break;
+                case SDLK_0:
+                    input->_0 = key_state;
+                    break;
                 case SDLK_SPACE:
                     input->space = key_state;
                     break;
                 case SDLK_ESCAPE:
                     input->esc = key_state;
                     break;
+                case SDLK_F1:
+                    input->f1 = key_state;
+                    break;
+                case SDLK_F2:
+                    input->f2 = key_state;
+                    break;
+                case SDLK_F3:
+                    if (key_state && !e->key.repeat)
+                    {
+                        print_frame_timings();
+                    }
+                    break;
             }
             break;
         }
@@ -239,10 +284,145 @@ static void poll_mouse()
 
     game_input->mouse_x = window_pixel_x;
     game_input->mouse_y = game_render_info.window_height - window_pixel_y;   // put 0,0 in lower left
+    game_input->window_width = game_render_info.window_width;
+    game_input->window_height = game_render_info.window_height;
+}
+
+static int sim_thread_proc(void* data)
+{
+    // the physics scopes go on their own track in traces
+    trace_set_thread_name("sim");
+
+    GameInputBuffer input_buffer{};
+    input_buffer.dt = target_frame_ms / 1000.0F;
+    FramePacer pacer;
+    frame_pacer_init(&pacer, (uint64_t)(target_frame_ms * 1e6F));
+
+    while (sim_running.load(std::memory_order_relaxed))
+    {
+        GameInput* input = input_buffer.advance();
+        SDL_LockMutex(sim_input_mutex);
+        *input = sim_input;
+        SDL_UnlockMutex(sim_input_mutex);
+        input->dt = input_buffer.dt;
+
+        input_recording_write_frame(&input_recording, &input_buffer);
+
+        uint64_t sim_start_time = SDL_GetPerformanceCounter();
+        game_update(&game_memory, &input_buffer);
+        uint64_t sim_ns = perf_counter_to_ns(SDL_GetPerformanceCounter() - sim_start_time);
+        SDL_LockMutex(sim_histogram_mutex);
+        histogram_record(&sim_histogram, sim_ns);
+        SDL_UnlockMutex(sim_histogram_mutex);
+
+        // simulation steps are a fixed dt, so they're paced to real time regardless of the render pacing
+        uint64_t overshoot_ns;
+        frame_pacer_wait(&pacer, &overshoot_ns);
+    }
+
+    frame_pacer_end(&pacer);
+    return 0;
+}
+
+#ifdef RENDERER_SOFTWARE
+/* Shows the software renderer's last frame, scaled to the window */
+static void present_software_frame()
+{
+    int width, height;
+    u32* pixels = sw_rendering_get_framebuffer(&width, &height);
+    if (!pixels)
+        return;
+
+    if (!texture || width != texture_width || height != texture_height)
+    {
+        SDL_DestroyTexture(texture);
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (!texture)
+        {
+            FATAL_PRINTF("Texture could not be created - SDL_Error: %s\n", SDL_GetError());
+        }
+        texture_width = width;
+        texture_height = height;
+    }
+    SDL_UpdateTexture(texture, NULL, pixels, width * BYTES_PER_PIXEL);
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+    SDL_RenderPresent(renderer);
+}
+#endif // RENDERER_SOFTWARE
+
+static void print_usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [--record <file>] [--replay <file>] [--scene <slot 0-9> <file>]... [--trace <file>] [--stats <file>] [--pacing sleep|vsync] [--capture <file prefix | file.raw>] [--pages default|huge|transparent] [--prefault] [--checkpoint <file>]\n", name);
 }
 
 int main(int argc, char* args[])
 {
+    const char* record_path = NULL;
+    const char* replay_path = NULL;
+    const char* capture_path = NULL;
+    GameMemoryOptions memory_options = {};
+#ifdef FIXED_GAME_MEMORY
+    memory_options.address = TEBIBYTES(2);
+#endif
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(args[i], "--record") && i + 1 < argc)
+        {
+            record_path = args[++i];
+        }
+        else if (!strcmp(args[i], "--replay") && i + 1 < argc)
+        {
+            replay_path = args[++i];
+        }
+        else if (!strcmp(args[i], "--trace") && i + 1 < argc)
+        {
+            game_memory.trace_path = args[++i];
+        }
+        else if (!strcmp(args[i], "--stats") && i + 1 < argc)
+        {
+            game_memory.stats_path = args[++i];
+        }
+        else if (!strcmp(args[i], "--capture") && i + 1 < argc)
+        {
+            capture_path = args[++i];
+        }
+        else if (!strcmp(args[i], "--pages") && i + 1 < argc
+                 && platform_parse_game_memory_pages(args[i + 1], &memory_options.pages))
+        {
+            ++i;
+        }
+        else if (!strcmp(args[i], "--prefault"))
+        {
+            memory_options.prefault = true;
+        }
+        else if (!strcmp(args[i], "--checkpoint") && i + 1 < argc)
+        {
+            memory_options.backing_path = args[++i];
+        }
+        else if (!strcmp(args[i], "--pacing") && i + 1 < argc
+                 && (!strcmp(args[i + 1], "sleep") || !strcmp(args[i + 1], "vsync")))
+        {
+            frame_pacing = strcmp(args[++i], "sleep") ? FRAME_PACING_VSYNC : FRAME_PACING_SLEEP;
+        }
+        else if (!strcmp(args[i], "--scene") && i + 2 < argc
+                 && args[i + 1][0] >= '0' && args[i + 1][0] <= '9' && args[i + 1][1] == '\0')
+        {
+            game_memory.scene_paths[args[i + 1][0] - '0'] = args[i + 2];
+            i += 2;
+        }
+        else
+        {
+            print_usage(args[0]);
+            return 1;
+        }
+    }
+    // recordings start from the scenes' initial states, not wherever a checkpoint left off
+    if ((record_path && replay_path) || ((record_path || replay_path) && memory_options.backing_path))
+    {
+        print_usage(args[0]);
+        return 1;
+    }
+    bool replaying = replay_path != NULL;
 
     // Init SDL and SDL_image
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER | SDL_INIT_AUDIO) < 0)
@@ -262,13 +442,29 @@ int main(int argc, char* args[])
         "Game",
         SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
         game_render_info.window_width, game_render_info.window_height,
+#ifdef RENDERER_GL
         SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+#else
+        SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_RESIZABLE);
+#endif
 
     if(window == NULL)
     {
         FATAL_PRINTF("Window could not be created - SDL_Error: %s\n", SDL_GetError());
     }
 
+#ifdef RENDERER_SOFTWARE
+    // Vsync only when it's doing the pacing; replays run as fast as possible
+    renderer = SDL_CreateRenderer(window, -1,
+        !replaying && frame_pacing == FRAME_PACING_VSYNC ? SDL_RENDERER_PRESENTVSYNC : 0);
+    if(renderer == NULL)
+    {
+        FATAL_PRINTF("Renderer could not be created - SDL_Error: %s\n", SDL_GetError());
+    }
+#elif defined(RENDERER_NULL)
+    // Nothing is shown, so there's no vsync to pace by
+    frame_pacing = FRAME_PACING_SLEEP;
+#else
     // Initialize openGL context
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, PLATFORM_GL_MAJOR_VERSION);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, PLATFORM_GL_MINOR_VERSION);
@@ -279,25 +475,25 @@ int main(int argc, char* args[])
         FATAL_PRINTF("OpenGL context could not be created - SDL_Error: %s\n", SDL_GetError());
     }
 
-    //Use Vsync
-    if(SDL_GL_SetSwapInterval(1) < 0)
+    // Vsync only when it's doing the pacing; replays run as fast as possible
+    if(SDL_GL_SetSwapInterval(!replaying && frame_pacing == FRAME_PACING_VSYNC ? 1 : 0) < 0)
     {
         FATAL_PRINTF("Warning: Unable to set VSync! SDL Error: %s\n", SDL_GetError());
     }
+#endif
 
     // init game memory
     game_memory.memory_size = GIBIBYTES(1);
-#ifdef FIXED_GAME_MEMORY
-    game_memory.memory = LARGE_ALLOC_FIXED(game_memory.memory_size, TEBIBYTES(2));
-#else
-    game_memory.memory = LARGE_ALLOC(game_memory.memory_size);
-#endif
+    game_memory.memory = platform_alloc_game_memory(game_memory.memory_size, &memory_options);
 
     if (!game_memory.memory)
     {
         FATAL_PRINTF("Couldn't allocate game memory\n");
     }
+    game_memory.memory_restored = memory_options.restored;
+#ifdef RENDERER_GL
     game_memory.platform_gl_get_proc_address = SDL_GL_GetProcAddress;
+#endif
 
     game_init_memory(&game_memory, &game_render_info);
 
@@ -306,66 +502,177 @@ int main(int argc, char* args[])
     // in seconds
     game_input_buffer.dt = target_frame_ms / 1000.0F;
 
+    if (record_path && !input_recording_begin(&input_recording, record_path))
+    {
+        FATAL_PRINTF("Couldn't record to \"%s\"\n", record_path);
+    }
+    if (replaying && !input_playback_begin(&input_playback, replay_path))
+    {
+        FATAL_PRINTF("Couldn't replay \"%s\"\n", replay_path);
+    }
+    if (capture_path)
+    {
+        if (!frame_capture_begin(&frame_capture, capture_path))
+        {
+            FATAL_PRINTF("Couldn't capture to \"%s\"\n", capture_path);
+        }
+        // replays aren't real time, so they can wait to get every frame
+        frame_capture.wait_for_buffers = replaying;
+        capturing = true;
+    }
+
     ////////////////////////////
     // Now do the game loop
     SDL_Event e;
 
     // timer
+    histogram_init(&frame_histogram, "frame");
+    histogram_init(&sim_histogram, "sim");
+    histogram_init(&render_histogram, "render");
+    histogram_init(&overshoot_histogram, "overshoot");
     uint64_t frame_start_time = SDL_GetPerformanceCounter();
+    uint64_t replay_start_time = frame_start_time;
+    frame_pacer_init(&frame_pacer, (uint64_t)(target_frame_ms * 1e6F));
+
+    if (!replaying)
+    {
+        sim_input_mutex = SDL_CreateMutex();
+        sim_histogram_mutex = SDL_CreateMutex();
+        sim_running = true;
+        sim_thread = SDL_CreateThread(sim_thread_proc, "sim", NULL);
+        if (!sim_input_mutex || !sim_histogram_mutex || !sim_thread)
+        {
+            FATAL_PRINTF("Couldn't start the simulation thread - SDL_Error: %s\n", SDL_GetError());
+        }
+    }
 
     while(running)
     {
         // Input
-        // advance game input buffer, and clear next entry
-        game_input_buffer.last = (game_input_buffer.last + 1) % GameInputBuffer::INPUT_BUFFER_SIZE;
-        memset(&game_input_buffer.buffer[game_input_buffer.last], 0, sizeof(GameInput));
-        // copy previous keyboard state (otherwise keys only fire on each keyboard event bounded by OS repeat rate)
-        game_input_buffer.buffer[game_input_buffer.last] = \
-            game_input_buffer.buffer[(game_input_buffer.last + GameInputBuffer::INPUT_BUFFER_SIZE - 1) % GameInputBuffer::INPUT_BUFFER_SIZE];
-
-        // TODO for now these dts are the same as we only poll once a frame
-        game_input_buffer.buffer[game_input_buffer.last].dt = game_input_buffer.dt;
-        
-        while (SDL_PollEvent(&e))
+        if (replaying)
+        {
+            // only listen for quit; input comes from the recording
+            while (SDL_PollEvent(&e))
+            {
+                if (e.type == SDL_QUIT)
+                {
+                    running = false;
+                }
+            }
+            if (!input_playback_read_frame(&input_playback, &game_input_buffer, &game_render_info))
+            {
+                break;
+            }
+
+            uint64_t sim_start_time = SDL_GetPerformanceCounter();
+            game_update(&game_memory, &game_input_buffer);
+            histogram_record(&sim_histogram, perf_counter_to_ns(SDL_GetPerformanceCounter() - sim_start_time));
+        }
+        else
         {
-            handle_event(&e);
+            game_input_buffer.advance();
+
+            while (SDL_PollEvent(&e))
+            {
+                handle_event(&e);
+            }
+            poll_mouse();
+
+            // hand it to the simulation thread, which picks up the latest on its next step
+            SDL_LockMutex(sim_input_mutex);
+            sim_input = *game_input_buffer.last_input();
+            SDL_UnlockMutex(sim_input_mutex);
         }
-        poll_mouse();
 
         // Rendering
-        // Call the game code
-        game_update_and_render(&game_memory, &game_input_buffer, &game_render_info);
+        // Call the game code, which draws the newest state the simulation has finished
+        uint64_t render_start_time = SDL_GetPerformanceCounter();
+        game_render(&game_memory, &game_render_info);
+        if (capturing && !rendering_capture_frame(frame_capture_add, &frame_capture))
+        {
+            if (frame_capture.wait_for_buffers)
+            {
+                rendering_flush_capture(frame_capture_add, &frame_capture);
+                rendering_capture_frame(frame_capture_add, &frame_capture);
+            }
+            else
+            {
+                frame_capture_drop(&frame_capture);
+            }
+        }
 
         // Swap buffers (actually make the image appear)
+#if defined(RENDERER_SOFTWARE)
+        present_software_frame();
+#elif defined(RENDERER_GL)
         SDL_GL_SwapWindow(window);
+#endif
 
         // Timing
         uint64_t frame_end_time = SDL_GetPerformanceCounter();
-        float frame_time_ms = 1000.0F * (float)(frame_end_time - frame_start_time)/(float)SDL_GetPerformanceFrequency();
-        float diff_ms = target_frame_ms - frame_time_ms;
-        int loops = 0;
-        while (diff_ms > 0.1F)
+        histogram_record(&render_histogram, perf_counter_to_ns(frame_end_time - render_start_time));
+        if (replaying)
         {
-            if (diff_ms > 1.5F)
+            histogram_record(&frame_histogram, perf_counter_to_ns(frame_end_time - frame_start_time));
+            frame_start_time = frame_end_time;
+            continue;
+        }
+        if (frame_pacing == FRAME_PACING_SLEEP)
+        {
+            uint64_t overshoot_ns;
+            if (frame_pacer_wait(&frame_pacer, &overshoot_ns))
             {
-                //DEBUG_PRINTF("sleeping for: %lf\n", diff_ms);
-                SDL_Delay((uint32_t)(diff_ms - 1.0F));
+                histogram_record(&overshoot_histogram, overshoot_ns);
             }
             frame_end_time = SDL_GetPerformanceCounter();
-            frame_time_ms = 1000.0F * (float)(frame_end_time - frame_start_time)/(float)SDL_GetPerformanceFrequency();
-            diff_ms = target_frame_ms - frame_time_ms;
-            loops++;
         }
-        //DEBUG_PRINTF("loops: %d\n", loops);
-        if (frame_time_ms > (target_frame_ms + 1.0F))
+        float frame_time_ms = 1000.0F * (float)(frame_end_time - frame_start_time)/(float)SDL_GetPerformanceFrequency();
+        histogram_record(&frame_histogram, perf_counter_to_ns(frame_end_time - frame_start_time));
+        avg_frame_ms = EXP_WEIGHTED_AVG(avg_frame_ms ? avg_frame_ms : frame_time_ms, FRAME_AVG_SAMPLES, frame_time_ms);
+        if (frame_histogram.count % target_framerate == 0)
         {
-            //DEBUG_PRINTF("frame_time_ms: %lf\n", frame_time_ms);
+            char title[64];
+            snprintf(title, sizeof(title), "Game - %.2f ms/frame", avg_frame_ms);
+            SDL_SetWindowTitle(window, title);
         }
         frame_start_time = frame_end_time;
 
     }
 
+    if (replaying)
+    {
+        float replay_ms = 1000.0F * (float)(SDL_GetPerformanceCounter() - replay_start_time)/(float)SDL_GetPerformanceFrequency();
+        printf("replayed %llu frames in %.3f ms\n", (unsigned long long)input_playback.num_frames, replay_ms);
+        input_playback_end(&input_playback);
+    }
+    if (sim_thread)
+    {
+        sim_running = false;
+        SDL_WaitThread(sim_thread, NULL);
+        SDL_DestroyMutex(sim_input_mutex);
+        SDL_DestroyMutex(sim_histogram_mutex);
+        sim_histogram_mutex = NULL;
+    }
+    input_recording_end(&input_recording);
+    if (capturing)
+    {
+        frame_capture.wait_for_buffers = true;
+        rendering_flush_capture(frame_capture_add, &frame_capture);
+        frame_capture_end(&frame_capture);
+    }
+    game_shutdown(&game_memory);
+    frame_pacer_end(&frame_pacer);
+    print_frame_timings();
+    // after game_shutdown, so the checkpoint is marked as safe to resume from
+    platform_sync_game_memory(game_memory.memory, game_memory.memory_size);
+    platform_free_game_memory(game_memory.memory, game_memory.memory_size);
+
+#ifdef RENDERER_SOFTWARE
+    SDL_DestroyTexture(texture);
+    SDL_DestroyRenderer(renderer);
+#elif defined(RENDERER_GL)
     SDL_GL_DeleteContext(gl_context);
+#endif
     SDL_DestroyWindow(window);
     SDL_Quit();
 
@@ -0,0 +1,37 @@
+/*
+ * Command line tool that prints a physics stats log (from --stats) as CSV
+ */
+#include"stats_log.h"
+
+int main(int argc, char* args[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <stats log>\n", args[0]);
+        return 1;
+    }
+
+    StatsLogReader reader;
+    if (!stats_log_open(&reader, args[1]))
+    {
+        fprintf(stderr, "Couldn't read \"%s\"\n", args[1]);
+        return 1;
+    }
+
+    printf("frame,live_bodies,pairs,collisions,iterations,collision_tests,invariant_failures\n");
+    PhysicsFrameStats stats;
+    while (stats_log_read_frame(&reader, &stats))
+    {
+        printf("%u,%u,%u,%u,%u,%u,%u\n",
+               stats.frame,
+               stats.live_bodies,
+               stats.pairs,
+               stats.collisions,
+               stats.iterations,
+               stats.collision_tests,
+               stats.invariant_failures);
+    }
+
+    stats_log_close(&reader);
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Writing and reading per-frame physics statistics logs
+ */
+#include"stats_log.h"
+
+bool stats_log_begin(StatsLog* log, const char* filename)
+{
+    log->num_frames = 0;
+    log->file = fopen(filename, "wb");
+    if (!log->file)
+    {
+        DEBUG_PRINTF("Couldn't open \"%s\" for physics stats\n", filename);
+        return false;
+    }
+
+    StatsLogHeader header = {};
+    header.magic = STATS_LOG_MAGIC;
+    header.version = STATS_LOG_VERSION;
+    header.frame_size = sizeof(PhysicsFrameStats);
+    if (fwrite(&header, sizeof(header), 1, log->file) != 1)
+    {
+        DEBUG_PRINTF("Couldn't write physics stats header\n");
+        fclose(log->file);
+        log->file = NULL;
+        return false;
+    }
+
+    DEBUG_PRINTF("Logging physics stats to \"%s\"\n", filename);
+    return true;
+}
+
+void stats_log_write_frame(StatsLog* log, PhysicsFrameStats* stats)
+{
+    if (!log->file)
+    {
+        return;
+    }
+
+    /* buffered by stdio, so this is a memcpy most frames */
+    if (fwrite(stats, sizeof(PhysicsFrameStats), 1, log->file) != 1)
+    {
+        DEBUG_PRINTF("Couldn't write physics stats frame %llu, stopping\n", (unsigned long long)log->num_frames);
+        stats_log_end(log);
+        return;
+    }
+    log->num_frames++;
+}
+
+void stats_log_end(StatsLog* log)
+{
+    if (!log->file)
+    {
+        return;
+    }
+    fclose(log->file);
+    log->file = NULL;
+    DEBUG_PRINTF("Logged physics stats for %llu frames\n", (unsigned long long)log->num_frames);
+}
+
+bool stats_log_open(StatsLogReader* reader, const char* filename)
+{
+    reader->file = fopen(filename, "rb");
+    if (!reader->file)
+    {
+        DEBUG_PRINTF("Couldn't open physics stats \"%s\"\n", filename);
+        return false;
+    }
+
+    StatsLogHeader header;
+    if (fread(&header, sizeof(header), 1, reader->file) != 1
+        || header.magic != STATS_LOG_MAGIC)
+    {
+        DEBUG_PRINTF("\"%s\" is not a physics stats log\n", filename);
+        stats_log_close(reader);
+        return false;
+    }
+    /* fields are only ever appended, so any version can be read */
+    if (header.frame_size == 0 || header.frame_size % sizeof(u32))
+    {
+        DEBUG_PRINTF("Bad physics stats frame size %u\n", header.frame_size);
+        stats_log_close(reader);
+        return false;
+    }
+    reader->frame_size = header.frame_size;
+    return true;
+}
+
+bool stats_log_read_frame(StatsLogReader* reader, PhysicsFrameStats* stats)
+{
+    if (!reader->file)
+    {
+        return false;
+    }
+
+    memset(stats, 0, sizeof(PhysicsFrameStats));
+    u32 read_size = reader->frame_size < sizeof(PhysicsFrameStats) ? reader->frame_size : (u32)sizeof(PhysicsFrameStats);
+    if (fread(stats, read_size, 1, reader->file) != 1)
+    {
+        return false;
+    }
+    /* skip fields from newer versions */
+    if (reader->frame_size > read_size && fseek(reader->file, reader->frame_size - read_size, SEEK_CUR))
+    {
+        return false;
+    }
+    return true;
+}
+
+void stats_log_close(StatsLogReader* reader)
+{
+    if (!reader->file)
+    {
+        return;
+    }
+    fclose(reader->file);
+    reader->file = NULL;
+}
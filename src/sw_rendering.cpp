@@ -0,0 +1,797 @@
+/*
+ * Implementation of rendering.h that rasterizes on the CPU into an RGBA8 framebuffer, for
+ * machines without a GPU or display. See sw_rendering.h for getting the frame out.
+ *
+ * Draws are recorded as commands in framebuffer pixel coords, and rasterized when the
+ * command buffer fills up or the frame ends. The framebuffer is split into bands of rows,
+ * which a pool of threads take one at a time, running every command that touches the band
+ * clipped to it. Each pixel is only ever written by one thread, in command order, so frames
+ * come out the same whatever the number of threads.
+ */
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<emmintrin.h>
+#define SW_SSE2
+#endif
+
+#include"rendering.h"
+#include"sw_rendering.h"
+
+struct SWTexture
+{
+    bool initialized;
+    uint32_t width;
+    uint32_t height;
+    u32* pixels;        // rows from the first given, like glTexImage2D
+    SWTexture* next_free;
+};
+
+enum SWCommandType
+{
+    SW_COMMAND_CLEAR,
+    SW_COMMAND_POLYGON,         // filled convex polygon
+    SW_COMMAND_TEXTURED_QUAD,   // parallelogram, with the texture stretched over it
+    SW_COMMAND_CIRCLE,          // filled ellipse, circles can be stretched by the viewport
+    SW_COMMAND_CIRCLE_OUTLINE,  // 1px ring
+    SW_COMMAND_LINE,            // 1px
+};
+
+struct SWCommand
+{
+    u32 type;
+    u32 color;
+    s32 min_y;          // rows touched, inclusive
+    s32 max_y;
+    u32 num_points;
+    f32 x[4];           // polygon corners, line ends, or the circle centre then radii
+    f32 y[4];
+
+    // Textured quad only: pixel coords to texture coords, relative to corner x[2], y[2]
+    SWTexture* texture;
+    f32 inverse[4];     // pixel offset to fractions along the two edges from the corner
+    f32 tex_origin[2];
+    f32 tex_u_axis[2];
+    f32 tex_v_axis[2];
+};
+
+static const int MAX_TEXTURES = 4096;
+static SWTexture textures[MAX_TEXTURES];
+static SWTexture* free_textures;    // linked through next_free
+
+#define MAX_SW_COMMANDS 65536
+static SWCommand commands[MAX_SW_COMMANDS];
+static u32 num_commands = 0;
+
+static u32* framebuffer = NULL;
+static int framebuffer_width = 0;
+static int framebuffer_height = 0;
+
+static RenderViewport viewport = {0, 0, GAME_WIDTH_PX, GAME_HEIGHT_PX};
+// Viewport in framebuffer rows and columns, nothing but the clear is drawn outside it
+static s32 clip_x0, clip_x1, clip_y0, clip_y1;
+
+static Vec2 camera_pos;
+static f32 camera_zoom = 1.0F;
+
+#define MAX_SW_THREADS 8
+#define SW_BAND_ROWS 16
+
+/*
+ * Threads rasterizing the commands. Allocated and never freed, so nothing is destroyed
+ * under the workers, which are detached and wait forever
+ */
+struct SWRasterizer
+{
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+    u32 generation;         // bumped to start the workers on the current commands
+    int num_working;
+    int num_workers;
+    std::atomic<int> next_band;
+    int num_bands;
+};
+static SWRasterizer* rasterizer = NULL;
+
+static u32 pack_color(f32 r, f32 g, f32 b)
+{
+    u32 ri = (u32)(r * 255.0F + 0.5F);
+    u32 gi = (u32)(g * 255.0F + 0.5F);
+    u32 bi = (u32)(b * 255.0F + 0.5F);
+    return ri | (gi << 8) | (bi << 16) | 0xFF000000;
+}
+
+/* Same as the GL shaders: color blended over white by its alpha */
+static u32 blend_color(Color color)
+{
+    return pack_color(
+        (1.0F - color.a) + color.r * color.a,
+        (1.0F - color.a) + color.g * color.a,
+        (1.0F - color.a) + color.b * color.a);
+}
+
+static s32 floor_to_int(f32 value)
+{
+    return (s32)floorf(value);
+}
+
+static s32 clamp_int(s32 value, s32 min, s32 max)
+{
+    return value < min ? min : value > max ? max : value;
+}
+
+/* Game coords to framebuffer pixel coords, with y going down */
+static Vec2 to_pixels(Vec2 pos)
+{
+    Vec2 view = (pos - camera_pos) * camera_zoom;
+    return Vec2(
+        (f32)viewport.x + (view.x + 1.0F) * 0.5F * (f32)viewport.width,
+        (f32)framebuffer_height - ((f32)viewport.y + (view.y + 1.0F) * 0.5F * (f32)viewport.height));
+}
+
+/*
+ * Rasterizing, all clipped to rows [band_y0, band_y1)
+ */
+
+static void fill_span(u32* row, s32 x0, s32 x1, u32 color)
+{
+    s32 x = x0;
+#ifdef SW_SSE2
+    __m128i color4 = _mm_set1_epi32((int)color);
+    for (; x + 4 <= x1; x += 4)
+    {
+        _mm_storeu_si128((__m128i*)(row + x), color4);
+    }
+#endif
+    for (; x < x1; ++x)
+    {
+        row[x] = color;
+    }
+}
+
+/* Fills [x_left, x_right) rounded to pixel centres, within the clip rect */
+static void fill_clipped_span(s32 y, f32 x_left, f32 x_right, u32 color)
+{
+    s32 x0 = clamp_int((s32)ceilf(x_left - 0.5F), clip_x0, clip_x1);
+    s32 x1 = clamp_int((s32)ceilf(x_right - 0.5F), clip_x0, clip_x1);
+    if (x0 < x1)
+    {
+        fill_span(framebuffer + y * framebuffer_width, x0, x1, color);
+    }
+}
+
+/* Rows of the command inside the band and clip rect, as [*y0, *y1) */
+static bool command_rows(SWCommand* command, s32 band_y0, s32 band_y1, s32* y0, s32* y1)
+{
+    *y0 = command->min_y > band_y0 ? command->min_y : band_y0;
+    *y0 = *y0 > clip_y0 ? *y0 : clip_y0;
+    *y1 = command->max_y + 1 < band_y1 ? command->max_y + 1 : band_y1;
+    *y1 = *y1 < clip_y1 ? *y1 : clip_y1;
+    return *y0 < *y1;
+}
+
+/* Where a convex polygon crosses the centre of row y */
+static bool polygon_span(SWCommand* command, s32 y, f32* x_left, f32* x_right)
+{
+    f32 yc = (f32)y + 0.5F;
+    f32 left = 1e30F;
+    f32 right = -1e30F;
+    for (u32 i = 0; i < command->num_points; ++i)
+    {
+        u32 j = (i + 1) % command->num_points;
+        f32 ya = command->y[i];
+        f32 yb = command->y[j];
+        if ((ya <= yc && yc < yb) || (yb <= yc && yc < ya))
+        {
+            f32 x = command->x[i] + (yc - ya) * (command->x[j] - command->x[i]) / (yb - ya);
+            left = x < left ? x : left;
+            right = x > right ? x : right;
+        }
+    }
+    *x_left = left;
+    *x_right = right;
+    return left <= right;
+}
+
+static void raster_polygon(SWCommand* command, s32 band_y0, s32 band_y1)
+{
+    s32 y0, y1;
+    if (!command_rows(command, band_y0, band_y1, &y0, &y1))
+        return;
+    for (s32 y = y0; y < y1; ++y)
+    {
+        f32 x_left, x_right;
+        if (polygon_span(command, y, &x_left, &x_right))
+        {
+            fill_clipped_span(y, x_left, x_right, command->color);
+        }
+    }
+}
+
+static void raster_textured_quad(SWCommand* command, s32 band_y0, s32 band_y1)
+{
+    s32 y0, y1;
+    if (!command_rows(command, band_y0, band_y1, &y0, &y1))
+        return;
+
+    SWTexture* texture = command->texture;
+    f32 blend_a = (f32)(command->color >> 24) / 255.0F;
+    f32 blend_r = (f32)(command->color & 0xFF) * blend_a;
+    f32 blend_g = (f32)((command->color >> 8) & 0xFF) * blend_a;
+    f32 blend_b = (f32)((command->color >> 16) & 0xFF) * blend_a;
+    for (s32 y = y0; y < y1; ++y)
+    {
+        f32 x_left, x_right;
+        if (!polygon_span(command, y, &x_left, &x_right))
+            continue;
+        s32 x0 = clamp_int((s32)ceilf(x_left - 0.5F), clip_x0, clip_x1);
+        s32 x1 = clamp_int((s32)ceilf(x_right - 0.5F), clip_x0, clip_x1);
+        u32* row = framebuffer + y * framebuffer_width;
+        f32 dy = (f32)y + 0.5F - command->y[2];
+        for (s32 x = x0; x < x1; ++x)
+        {
+            f32 dx = (f32)x + 0.5F - command->x[2];
+            f32 a = command->inverse[0] * dx + command->inverse[1] * dy;
+            f32 b = command->inverse[2] * dx + command->inverse[3] * dy;
+            f32 u = command->tex_origin[0] + a * command->tex_u_axis[0] + b * command->tex_v_axis[0];
+            f32 v = command->tex_origin[1] + a * command->tex_u_axis[1] + b * command->tex_v_axis[1];
+            s32 tx = clamp_int((s32)(u * (f32)texture->width), 0, texture->width - 1);
+            s32 ty = clamp_int((s32)(v * (f32)texture->height), 0, texture->height - 1);
+            u32 texel = texture->pixels[ty * texture->width + tx];
+            // same alpha test as shaders/sprite.frag
+            if ((texel >> 24) < 26)
+                continue;
+            f32 keep = 1.0F - blend_a;
+            row[x] = pack_color(
+                ((f32)(texel & 0xFF) * keep + blend_r) / 255.0F,
+                ((f32)((texel >> 8) & 0xFF) * keep + blend_g) / 255.0F,
+                ((f32)((texel >> 16) & 0xFF) * keep + blend_b) / 255.0F);
+        }
+    }
+}
+
+/* Where an ellipse crosses the centre of row y */
+static bool ellipse_span(f32 cx, f32 cy, f32 rx, f32 ry, s32 y, f32* x_left, f32* x_right)
+{
+    if (rx <= 0.0F || ry <= 0.0F)
+        return false;
+    f32 dy = ((f32)y + 0.5F - cy) / ry;
+    if (dy <= -1.0F || dy >= 1.0F)
+        return false;
+    f32 half_width = rx * sqrtf(1.0F - dy * dy);
+    *x_left = cx - half_width;
+    *x_right = cx + half_width;
+    return true;
+}
+
+static void raster_circle(SWCommand* command, s32 band_y0, s32 band_y1)
+{
+    s32 y0, y1;
+    if (!command_rows(command, band_y0, band_y1, &y0, &y1))
+        return;
+    f32 cx = command->x[0];
+    f32 cy = command->y[0];
+    f32 rx = command->x[1];
+    f32 ry = command->y[1];
+    for (s32 y = y0; y < y1; ++y)
+    {
+        f32 x_left, x_right;
+        if (!ellipse_span(cx, cy, rx, ry, y, &x_left, &x_right))
+            continue;
+        f32 inner_left, inner_right;
+        if (command->type == SW_COMMAND_CIRCLE_OUTLINE &&
+            ellipse_span(cx, cy, rx - 1.0F, ry - 1.0F, y, &inner_left, &inner_right))
+        {
+            // the ring is what's left of the span around a 1px smaller ellipse
+            fill_clipped_span(y, x_left, inner_left, command->color);
+            fill_clipped_span(y, inner_right, x_right, command->color);
+        }
+        else
+        {
+            fill_clipped_span(y, x_left, x_right, command->color);
+        }
+    }
+}
+
+static void plot(s32 x, s32 y, u32 color)
+{
+    if (x >= clip_x0 && x < clip_x1)
+    {
+        framebuffer[y * framebuffer_width + x] = color;
+    }
+}
+
+/* DDA along the longer axis, one pixel per row or column */
+static void raster_line(SWCommand* command, s32 band_y0, s32 band_y1)
+{
+    s32 y0, y1;
+    if (!command_rows(command, band_y0, band_y1, &y0, &y1))
+        return;
+    f32 ax = command->x[0];
+    f32 ay = command->y[0];
+    f32 dx = command->x[1] - ax;
+    f32 dy = command->y[1] - ay;
+
+    if (fabsf(dy) >= fabsf(dx))
+    {
+        if (dy == 0.0F)
+            return;
+        for (s32 y = y0; y < y1; ++y)
+        {
+            f32 t = ((f32)y + 0.5F - ay) / dy;
+            if (t < 0.0F || t > 1.0F)
+                continue;
+            plot(floor_to_int(ax + t * dx), y, command->color);
+        }
+        return;
+    }
+
+    // only the columns whose row is in [y0, y1)
+    f32 t_min = 0.0F;
+    f32 t_max = 1.0F;
+    if (dy != 0.0F)
+    {
+        f32 ta = ((f32)y0 - ay) / dy;
+        f32 tb = ((f32)y1 - ay) / dy;
+        t_min = ta < tb ? ta : tb;
+        t_max = ta < tb ? tb : ta;
+        t_min = t_min > 0.0F ? t_min : 0.0F;
+        t_max = t_max < 1.0F ? t_max : 1.0F;
+    }
+    f32 xa = ax + t_min * dx;
+    f32 xb = ax + t_max * dx;
+    s32 x0 = floor_to_int(xa < xb ? xa : xb) - 1;
+    s32 x1 = floor_to_int(xa < xb ? xb : xa) + 1;
+    for (s32 x = x0; x <= x1; ++x)
+    {
+        f32 t = ((f32)x + 0.5F - ax) / dx;
+        if (t < 0.0F || t > 1.0F)
+            continue;
+        s32 y = floor_to_int(ay + t * dy);
+        if (y >= y0 && y < y1)
+        {
+            plot(x, y, command->color);
+        }
+    }
+}
+
+static void raster_band(s32 band_y0, s32 band_y1)
+{
+    for (u32 i = 0; i < num_commands; ++i)
+    {
+        SWCommand* command = &commands[i];
+        if (command->max_y < band_y0 || command->min_y >= band_y1)
+            continue;
+        switch (command->type)
+        {
+            case SW_COMMAND_CLEAR:
+                for (s32 y = band_y0; y < band_y1; ++y)
+                {
+                    fill_span(framebuffer + y * framebuffer_width, 0, framebuffer_width, command->color);
+                }
+                break;
+            case SW_COMMAND_POLYGON:
+                raster_polygon(command, band_y0, band_y1);
+                break;
+            case SW_COMMAND_TEXTURED_QUAD:
+                raster_textured_quad(command, band_y0, band_y1);
+                break;
+            case SW_COMMAND_CIRCLE:
+            case SW_COMMAND_CIRCLE_OUTLINE:
+                raster_circle(command, band_y0, band_y1);
+                break;
+            case SW_COMMAND_LINE:
+                raster_line(command, band_y0, band_y1);
+                break;
+        }
+    }
+}
+
+/* Takes bands until there are none left */
+static void raster_bands()
+{
+    for (;;)
+    {
+        int band = rasterizer->next_band.fetch_add(1);
+        if (band >= rasterizer->num_bands)
+            break;
+        s32 y0 = band * SW_BAND_ROWS;
+        s32 y1 = y0 + SW_BAND_ROWS < framebuffer_height ? y0 + SW_BAND_ROWS : framebuffer_height;
+        raster_band(y0, y1);
+    }
+}
+
+static void raster_worker()
+{
+    u32 seen_generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(rasterizer->mutex);
+            rasterizer->start.wait(lock, [&]{ return rasterizer->generation != seen_generation; });
+            seen_generation = rasterizer->generation;
+        }
+        raster_bands();
+        {
+            std::lock_guard<std::mutex> lock(rasterizer->mutex);
+            rasterizer->num_working--;
+        }
+        rasterizer->done.notify_one();
+    }
+}
+
+/* Rasterizes and clears the recorded commands, on this thread and the workers */
+static void flush_commands()
+{
+    if (!num_commands || !framebuffer)
+    {
+        num_commands = 0;
+        return;
+    }
+
+    rasterizer->num_bands = (framebuffer_height + SW_BAND_ROWS - 1) / SW_BAND_ROWS;
+    rasterizer->next_band = 0;
+    if (rasterizer->num_workers)
+    {
+        std::lock_guard<std::mutex> lock(rasterizer->mutex);
+        rasterizer->num_working = rasterizer->num_workers;
+        rasterizer->generation++;
+    }
+    rasterizer->start.notify_all();
+
+    raster_bands();
+
+    std::unique_lock<std::mutex> lock(rasterizer->mutex);
+    rasterizer->done.wait(lock, [&]{ return rasterizer->num_working == 0; });
+
+    num_commands = 0;
+}
+
+static SWCommand* add_command(SWCommandType type, u32 color)
+{
+    if (num_commands == MAX_SW_COMMANDS)
+    {
+        flush_commands();
+    }
+    SWCommand* command = &commands[num_commands++];
+    command->type = type;
+    command->color = color;
+    return command;
+}
+
+/* Sets min_y and max_y from the command's first num_points points */
+static void set_command_rows(SWCommand* command, u32 num_points)
+{
+    f32 min = command->y[0];
+    f32 max = command->y[0];
+    for (u32 i = 1; i < num_points; ++i)
+    {
+        min = command->y[i] < min ? command->y[i] : min;
+        max = command->y[i] > max ? command->y[i] : max;
+    }
+    command->min_y = floor_to_int(min) - 1;
+    command->max_y = floor_to_int(max) + 1;
+}
+
+static void add_line(Vec2 a, Vec2 b, u32 color)
+{
+    SWCommand* command = add_command(SW_COMMAND_LINE, color);
+    command->x[0] = a.x;
+    command->y[0] = a.y;
+    command->x[1] = b.x;
+    command->y[1] = b.y;
+    command->num_points = 2;
+    set_command_rows(command, 2);
+}
+
+/* Corners of a rect in pixels: top right, top left, bottom left, bottom right in game space */
+static void rect_corners(Vec2 pos, f32 rot, Vec2 size, Vec2* corners)
+{
+    Vec2 half = size * 0.5F;
+    corners[0] = to_pixels(pos + Vec2(half.x, half.y).rotate(rot));
+    corners[1] = to_pixels(pos + Vec2(-half.x, half.y).rotate(rot));
+    corners[2] = to_pixels(pos + Vec2(-half.x, -half.y).rotate(rot));
+    corners[3] = to_pixels(pos + Vec2(half.x, -half.y).rotate(rot));
+}
+
+static void add_polygon(Vec2* points, u32 num_points, u32 color)
+{
+    SWCommand* command = add_command(SW_COMMAND_POLYGON, color);
+    for (u32 i = 0; i < num_points; ++i)
+    {
+        command->x[i] = points[i].x;
+        command->y[i] = points[i].y;
+    }
+    command->num_points = num_points;
+    set_command_rows(command, num_points);
+}
+
+/* Outline of the two triangles the GL renderer's wireframe shows */
+static void add_wireframe_quad(Vec2* corners, u32 color)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        add_line(corners[i], corners[(i + 1) % 4], color);
+    }
+    add_line(corners[0], corners[2], color);
+}
+
+static void draw_textured_quad(Vec2 pos, f32 rot, Vec2 size, SWTexture* texture, const f32* tex_coords, Color color)
+{
+    Vec2 corners[4];
+    rect_corners(pos, rot, size, corners);
+
+    SWCommand* command = add_command(SW_COMMAND_TEXTURED_QUAD, 0);
+    // alpha is kept for blending per texel, rather than blended over white now
+    command->color = pack_color(color.r, color.g, color.b) & 0x00FFFFFF;
+    command->color |= (u32)(color.a * 255.0F + 0.5F) << 24;
+    for (int i = 0; i < 4; ++i)
+    {
+        command->x[i] = corners[i].x;
+        command->y[i] = corners[i].y;
+    }
+    command->num_points = 4;
+    set_command_rows(command, 4);
+
+    // edges from the bottom left corner, to the bottom right and the top left
+    f32 ux = corners[3].x - corners[2].x;
+    f32 uy = corners[3].y - corners[2].y;
+    f32 vx = corners[1].x - corners[2].x;
+    f32 vy = corners[1].y - corners[2].y;
+    f32 det = ux * vy - vx * uy;
+    if (det == 0.0F)
+    {
+        num_commands--;
+        return;
+    }
+    command->inverse[0] = vy / det;
+    command->inverse[1] = -vx / det;
+    command->inverse[2] = -uy / det;
+    command->inverse[3] = ux / det;
+
+    // tex_coords are in the corners' order, as u, v pairs
+    command->texture = texture;
+    command->tex_origin[0] = tex_coords[4];
+    command->tex_origin[1] = tex_coords[5];
+    command->tex_u_axis[0] = tex_coords[6] - tex_coords[4];
+    command->tex_u_axis[1] = tex_coords[7] - tex_coords[5];
+    command->tex_v_axis[0] = tex_coords[2] - tex_coords[4];
+    command->tex_v_axis[1] = tex_coords[3] - tex_coords[5];
+}
+
+static void resize_framebuffer(int width, int height)
+{
+    flush_commands();
+    free(framebuffer);
+    framebuffer = (u32*)malloc((size_t)width * (size_t)height * sizeof(u32));
+    if (!framebuffer)
+    {
+        FATAL_PRINTF("Couldn't allocate %dx%d framebuffer\n", width, height);
+    }
+    memset(framebuffer, 0, (size_t)width * (size_t)height * sizeof(u32));
+    framebuffer_width = width;
+    framebuffer_height = height;
+
+    viewport = RenderViewport::fit_to_window(width, height);
+    clip_x0 = clamp_int(viewport.x, 0, width);
+    clip_x1 = clamp_int(viewport.x + viewport.width, 0, width);
+    clip_y0 = clamp_int(height - (viewport.y + viewport.height), 0, height);
+    clip_y1 = clamp_int(height - viewport.y, 0, height);
+}
+
+void rendering_init(GameMemory* game_memory, GameRenderInfo* render_info, float width, float height)
+{
+    rasterizer = new SWRasterizer();
+    rasterizer->generation = 0;
+    rasterizer->num_working = 0;
+
+    // this thread rasterizes too
+    int num_threads = (int)std::thread::hardware_concurrency();
+    num_threads = num_threads < 1 ? 1 : num_threads > MAX_SW_THREADS ? MAX_SW_THREADS : num_threads;
+    rasterizer->num_workers = num_threads - 1;
+    for (int i = 0; i < rasterizer->num_workers; ++i)
+    {
+        std::thread(raster_worker).detach();
+    }
+    DEBUG_PRINTF("Software renderer with %d threads\n", num_threads);
+
+    for (int i = MAX_TEXTURES - 1; i >= 0; --i)
+    {
+        textures[i].next_free = free_textures;
+        free_textures = &textures[i];
+    }
+
+    resize_framebuffer(render_info->window_width, render_info->window_height);
+}
+
+u32* sw_rendering_get_framebuffer(int* width, int* height)
+{
+    *width = framebuffer_width;
+    *height = framebuffer_height;
+    return framebuffer;
+}
+
+Vec2 rendering_window_pos_to_viewport_pos(int x, int y)
+{
+    return viewport.window_pos_to_viewport_pos(x, y);
+}
+
+RenderTexture rendering_create_texture(void* image_data, uint32_t width, uint32_t height)
+{
+    SWTexture* ret = free_textures;
+    if (!ret)
+    {
+        DEBUG_PRINTF("ERROR: Failed to allocate texture\n");
+        return NULL;
+    }
+    ret->pixels = (u32*)malloc(width * height * sizeof(u32));
+    if (!ret->pixels)
+    {
+        DEBUG_PRINTF("ERROR: Failed to allocate texture memory\n");
+        return NULL;
+    }
+    memcpy(ret->pixels, image_data, width * height * sizeof(u32));
+    free_textures = ret->next_free;
+    ret->width = width;
+    ret->height = height;
+    ret->initialized = true;
+    return ret;
+}
+
+void rendering_replace_texture(RenderTexture _tex, void* image_data)
+{
+    SWTexture* tex = (SWTexture*)_tex;
+    // commands already recorded have to see the old one
+    flush_commands();
+    memcpy(tex->pixels, image_data, tex->width * tex->height * sizeof(u32));
+}
+
+void rendering_destroy_texture(RenderTexture _tex)
+{
+    SWTexture* tex = (SWTexture*)_tex;
+    DEBUG_ASSERT(tex->initialized);
+    // commands already recorded may still use it
+    flush_commands();
+    free(tex->pixels);
+    tex->pixels = NULL;
+    tex->initialized = false;
+    tex->next_free = free_textures;
+    free_textures = tex;
+}
+
+void rendering_clear_screen(GameRenderInfo* render_info, Color color)
+{
+    if (render_info->resized)
+    {
+        resize_framebuffer(render_info->window_width, render_info->window_height);
+        render_info->resized = false;
+    }
+    SWCommand* command = add_command(SW_COMMAND_CLEAR, pack_color(color.r, color.g, color.b));
+    command->min_y = 0;
+    command->max_y = framebuffer_height - 1;
+}
+
+void rendering_set_camera(Vec2 pos, f32 zoom)
+{
+    DEBUG_ASSERT(zoom > 0.0F);
+    camera_pos = pos;
+    camera_zoom = zoom;
+}
+
+void rendering_draw_rect(Vec2 pos, f32 rot, Vec2 size, RenderTexture tex, Color color, bool wireframe)
+{
+    Vec2 corners[4];
+    if (tex && !wireframe)
+    {
+        static const f32 DEFAULT_TEX_COORDS[8] = {1, 1, 0, 1, 0, 0, 1, 0};
+        draw_textured_quad(pos, rot, size, (SWTexture*)tex, DEFAULT_TEX_COORDS, color);
+        return;
+    }
+    rect_corners(pos, rot, size, corners);
+    if (wireframe)
+    {
+        add_wireframe_quad(corners, blend_color(color));
+    }
+    else
+    {
+        add_polygon(corners, 4, blend_color(color));
+    }
+}
+
+void rendering_draw_circle(Vec2 pos, f32 rot, f32 radius, Color color, bool wireframe)
+{
+    u32 packed = blend_color(color);
+    Vec2 centre = to_pixels(pos);
+    SWCommand* command = add_command(wireframe ? SW_COMMAND_CIRCLE_OUTLINE : SW_COMMAND_CIRCLE, packed);
+    command->x[0] = centre.x;
+    command->y[0] = centre.y;
+    command->x[1] = radius * camera_zoom * 0.5F * (f32)viewport.width;
+    command->y[1] = radius * camera_zoom * 0.5F * (f32)viewport.height;
+    command->num_points = 1;
+    command->min_y = floor_to_int(centre.y - command->y[1]) - 1;
+    command->max_y = floor_to_int(centre.y + command->y[1]) + 1;
+    if (wireframe)
+    {
+        // a radius to show the rotation, like shaders/circle.frag
+        add_line(centre, to_pixels(pos + Vec2(radius, 0.0F).rotate(rot)), packed);
+    }
+}
+
+void rendering_draw_sprite(Vec2 pos, Vec2 size, RenderTexture tex, uint32_t row, uint32_t col, Color color, bool hflip)
+{
+    SWTexture* texture = (SWTexture*)tex;
+    DEBUG_ASSERT(texture && texture->initialized);
+
+    // Same crop as gl_rendering.cpp
+    float sprite_frac_width = (float)size.x / (float)texture->width;
+    float sprite_frac_height = (float)size.y / (float)texture->height;
+    float bottom_left_x = col * sprite_frac_width;
+    float bottom_left_y = 1.0F - (sprite_frac_height * (row + 1));
+    f32 tex_coords[8] = {
+        hflip ? bottom_left_x : bottom_left_x + sprite_frac_width,
+        bottom_left_y + sprite_frac_height,
+        hflip ? bottom_left_x + sprite_frac_width : bottom_left_x,
+        bottom_left_y + sprite_frac_height,
+        hflip ? bottom_left_x + sprite_frac_width : bottom_left_x,
+        bottom_left_y,
+        hflip ? bottom_left_x : bottom_left_x + sprite_frac_width,
+        bottom_left_y
+    };
+    draw_textured_quad(pos, 0, size, texture, tex_coords, color);
+}
+
+void rendering_draw_line(Vec2 origin, Vec2 point, float width, Color color)
+{
+    u32 packed = blend_color(color);
+    Vec2 a = to_pixels(origin);
+    Vec2 b = to_pixels(origin + point);
+    if (width <= 1.0F)
+    {
+        add_line(a, b, packed);
+        return;
+    }
+
+    // wider lines are quads, like gl_rendering.cpp
+    Vec2 along = b - a;
+    f32 length = along.length();
+    if (length == 0.0F)
+        return;
+    Vec2 side = Vec2(-along.y, along.x) * (width * 0.5F / length);
+    Vec2 corners[4] = {a + side, a - side, b - side, b + side};
+    add_polygon(corners, 4, packed);
+}
+
+/* There's nothing to cache; the draws are cheap to record and get rasterized either way */
+bool rendering_begin_static_layer(u32 version)
+{
+    return true;
+}
+
+void rendering_end_static_layer()
+{
+}
+
+void rendering_end_frame()
+{
+    flush_commands();
+}
+
+/* The frame is already in memory, so it's passed on straight away */
+bool rendering_capture_frame(RenderCaptureCallback callback, void* user)
+{
+    s32 width = clip_x1 - clip_x0;
+    s32 height = clip_y1 - clip_y0;
+    if (!framebuffer || width <= 0 || height <= 0)
+        return false;
+    u32* first_row = framebuffer + clip_y0 * framebuffer_width + clip_x0;
+    callback(user, (u8*)first_row, (s64)framebuffer_width * sizeof(u32), width, height);
+    return true;
+}
+
+void rendering_flush_capture(RenderCaptureCallback callback, void* user)
+{
+}
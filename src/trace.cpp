@@ -0,0 +1,189 @@
+#ifdef PROFILER
+
+#include<atomic>
+#include<mutex>
+
+#include"trace.h"
+
+static const char *phase_names[PROFILE_NUM_PHASES] = {
+    "forces",
+    "aabb",
+    "broad",
+    "narrow",
+    "toi",
+    "solve",
+    "render",
+};
+
+static const char *counter_names[TRACE_NUM_COUNTERS] = {
+    "pairs",
+    "collisions",
+    "iter",
+};
+
+enum TraceEventType
+{
+    TRACE_EVENT_COMPLETE,
+    TRACE_EVENT_COUNTER,
+    TRACE_EVENT_THREAD_NAME,
+};
+
+struct TraceEvent
+{
+    u64 start;
+    u64 value;          // duration in ticks for complete events
+    const char *name;
+    u32 tid;
+    u32 type;
+};
+
+/* Events are buffered and written out in one go when the buffer fills up */
+#define TRACE_BUFFER_EVENTS 16384
+
+struct Trace
+{
+    std::mutex mutex;
+    FILE *file;
+    u32 capture;        // bumped for every capture, so thread names are written once per file
+    u64 start_ticks;
+    u32 num_written;
+    u32 num_events;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+};
+
+static Trace trace;
+
+static std::atomic<u32> next_tid{1};
+static thread_local u32 thread_tid;
+static thread_local u32 thread_named_capture;
+static thread_local const char *thread_name;
+
+static void write_events()
+{
+    f64 us_per_tick = 1e6 / profiler.ticks_per_second;
+    for (u32 i = 0; i < trace.num_events; ++i)
+    {
+        TraceEvent *event = &trace.events[i];
+        /* events from before the capture started can show up from scopes that were already open */
+        f64 ts = event->start > trace.start_ticks ? (f64)(event->start - trace.start_ticks) * us_per_tick : 0.0;
+        const char *separator = trace.num_written++ ? ",\n" : "";
+        switch (event->type)
+        {
+            case TRACE_EVENT_COMPLETE:
+                fprintf(trace.file,
+                        "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        separator, event->name, event->tid, ts, (f64)event->value * us_per_tick);
+                break;
+            case TRACE_EVENT_COUNTER:
+                fprintf(trace.file,
+                        "%s{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%llu}}",
+                        separator, event->name, event->tid, ts, (unsigned long long)event->value);
+                break;
+            case TRACE_EVENT_THREAD_NAME:
+                fprintf(trace.file,
+                        "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                        separator, event->tid, event->name);
+                break;
+        }
+    }
+    trace.num_events = 0;
+}
+
+static void add_event(u32 type, const char *name, u64 start, u64 value)
+{
+    if (!thread_tid)
+    {
+        thread_tid = next_tid++;
+    }
+
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    if (!trace.file)
+        return;
+
+    /* two slots: the thread name might go in first */
+    if (trace.num_events + 2 > TRACE_BUFFER_EVENTS)
+    {
+        write_events();
+    }
+    if (thread_named_capture != trace.capture)
+    {
+        thread_named_capture = trace.capture;
+        char default_name[32];
+        const char *track_name = thread_name;
+        if (!track_name)
+        {
+            snprintf(default_name, sizeof(default_name), "thread %u", thread_tid);
+            track_name = default_name;
+        }
+        /* the name is written out right away, so the stack buffer is fine */
+        trace.events[trace.num_events++] = TraceEvent{0, 0, track_name, thread_tid, TRACE_EVENT_THREAD_NAME};
+        write_events();
+    }
+    trace.events[trace.num_events++] = TraceEvent{start, value, name, thread_tid, type};
+}
+
+bool trace_begin(const char *filename)
+{
+    trace_end();
+    /* timestamps are converted when they're written, which needs the tick rate */
+    profiler_calibrate();
+
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    trace.file = fopen(filename, "wb");
+    if (!trace.file)
+    {
+        DEBUG_PRINTF("Couldn't open \"%s\" for tracing\n", filename);
+        return false;
+    }
+    fprintf(trace.file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    trace.capture++;
+    trace.start_ticks = profiler_ticks();
+    trace.num_written = 0;
+    trace.num_events = 0;
+    profiler.tracing = true;
+
+    DEBUG_PRINTF("Tracing to \"%s\"\n", filename);
+    return true;
+}
+
+void trace_end()
+{
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    if (!trace.file)
+        return;
+
+    profiler.tracing = false;
+    write_events();
+    fprintf(trace.file, "\n]}\n");
+    fclose(trace.file);
+    trace.file = NULL;
+
+    DEBUG_PRINTF("Trace written, %u events\n", trace.num_written);
+}
+
+bool trace_active()
+{
+    return profiler.tracing;
+}
+
+void trace_set_thread_name(const char *name)
+{
+    thread_name = name;
+}
+
+void trace_phase(ProfilePhase phase, u64 start, u64 ticks)
+{
+    add_event(TRACE_EVENT_COMPLETE, phase_names[phase], start, ticks);
+}
+
+void trace_counter(TraceCounter counter, u64 value)
+{
+    add_event(TRACE_EVENT_COUNTER, counter_names[counter], profiler_ticks(), value);
+}
+
+void trace_frame(u64 start, u64 ticks)
+{
+    add_event(TRACE_EVENT_COMPLETE, "frame", start, ticks);
+}
+
+#endif // PROFILER